@@ -0,0 +1,50 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** digest.c
+**
+*/
+
+//: PLAYERCOMMAND
+//$$ see: verbose, hp
+// USAGE digest
+//      digest full|pairs|room
+//
+// This shows how much you see of fights you are watching, and allows you
+// to change it. Your own blows, and the blows aimed at you, are always
+// shown in full.
+//
+//  full  - every blow between other fighters (the default)
+//  pairs - one line per fighter at the end of each round, saying how
+//          often they hit and missed, and how hard
+//  room  - one line at the end of each round for everything around you
+//
+// In big fights "pairs" or "room" keep the screen readable.
+
+#include <combat_config.h>
+
+#define USAGE "Usage: digest [full|pairs|room]\n"
+#define LEVELS ({"full", "pairs", "room"})
+
+inherit CMD;
+
+nomask private void main(string arg)
+{
+   int level;
+
+   if (!arg || arg == "")
+   {
+      out("Combat digest is " + LEVELS[this_body()->query_combat_digest()] + ".\n" + USAGE);
+      return;
+   }
+
+   level = member_array(arg, LEVELS);
+   if (level == -1)
+   {
+      out(USAGE);
+      return;
+   }
+
+   this_body()->set_combat_digest(level);
+   out("Combat digest is now " + arg + ".\n");
+}
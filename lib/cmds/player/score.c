@@ -234,18 +234,37 @@ string score_cmd(object body, int width)
    return content;
 }
 
-private
-void main(string arg)
+//: FUNCTION get_score_string
+// Returns the score frame for body with the given title, as the score
+// command shows it.
+string get_score_string(object body, string title)
 {
-   object body;
    string content;
    int num_cur;
    int width = default_user_width() - 11; // Size of left header and space between.
-   body = this_body();
 
    // Frame initializations
    frame_init_user();
    set_frame_left_header(); // This frame will use left header
+   set_frame_title(title);
+
+   content = score_cmd(body, width);
+
+   num_cur = sizeof(body->query_currencies());
+   set_frame_header(" \nExp\n\n\nMoney" + repeat_string("\n", num_cur || 1) + "\nStats\n\n\n\n\nOther\n\n" +
+#ifdef USE_KARMA
+                    "Karma\n\n" +
+#endif
+                    "\nWeight");
+   set_frame_content(content);
+   return frame_render();
+}
+
+private
+void main(string arg)
+{
+   object body = this_body();
+   string title = "Score"; // Title of frame
 
    if (strlen(arg) > 0 && wizardp(this_user()))
    {
@@ -259,19 +278,8 @@ void main(string arg)
             return;
          }
       }
-      set_frame_title("Score for " + capitalize(arg)); // Title of frame for other people
+      title = "Score for " + capitalize(arg); // Title of frame for other people
    }
-   else
-      set_frame_title("Score"); // Title of frame
 
-   content = score_cmd(body, width);
-
-   num_cur = sizeof(body->query_currencies());
-   set_frame_header(" \nExp\n\n\nMoney" + repeat_string("\n", num_cur || 1) + "\nStats\n\n\n\n\nOther\n\n" +
-#ifdef USE_KARMA
-                    "Karma\n\n" +
-#endif
-                    "\nWeight");
-   set_frame_content(content);
-   write(frame_render());
+   write(get_score_string(body, title));
 }
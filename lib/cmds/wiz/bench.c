@@ -0,0 +1,43 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+//: COMMAND
+//$$ see: profile, cpu
+// USAGE:  bench
+//         bench <name> [iterations]
+//
+// Runs one of the mudlib micro-benchmarks found in /obj/bench and prints
+// its report.  Without arguments the available benchmarks are listed.
+//
+// Benchmarks run inside a single evaluation, so keep the iteration count
+// modest or raise the eval limit first.
+
+inherit CMD;
+
+#define BENCH_DIR "/obj/bench/"
+
+private
+void main(string arg)
+{
+   string name;
+   int iterations;
+   object ob;
+
+   if (!arg || arg == "")
+   {
+      string *names = map(get_dir(BENCH_DIR + "*.c"), ( : $1[0.. < 3] :));
+
+      outf("Available benchmarks: %s\n", sizeof(names) ? implode(names, ", ") : "none");
+      return;
+   }
+
+   if (sscanf(arg, "%s %d", name, iterations) != 2)
+      name = arg;
+
+   if (!(ob = load_object(BENCH_DIR + name)) || !function_exists("bench", ob))
+   {
+      outf("No such benchmark: %s\n", name);
+      return;
+   }
+
+   out(ob->bench(iterations));
+}
@@ -13,7 +13,7 @@ void main(string arg)
 {
    object *mobs;
    mapping counts = ([]);
-   mobs = filter_array(objects(), ( : !$1->is_body() && clonep($1) && $1->attackable() :));
+   mobs = filter_array(REGISTRY_D->query_type("living"), ( : !$1->is_body() && $1->attackable() :));
    write("--------------\nLivings found\n--------------\n");
 
    foreach (object mob in mobs)
@@ -12,6 +12,7 @@
 //$$ see: objdump, objfind
 // USAGE: objcount
 //       objcount <minimum>
+//       objcount -v
 //
 // This command is used to find objects that have more than one instance.
 // The number of instances (including blueprint) for each qualifying item
@@ -23,20 +24,33 @@
 // When the optional "minimum" parameter is used, this ignores any items
 // where the number of instances (excluding blueprint) is less than the number
 // Thus "objcounts 2" lists items with 3 or more non-blueprint instances,
+//
+// The counts come from REGISTRY_D, which only knows clones of OBJECT.
+// objcount -v checks the registry against every object loaded.
 
 inherit CMD;
 
 private
-void main(mixed args)
+void main(mixed args, mapping flags)
 {
-   mapping counts = ([]);
+   mapping counts;
+
+   if (flags["v"])
+   {
+      mapping result = REGISTRY_D->verify();
 
-   objects(( : $(counts)[base_name($1)]++ :));
+      outf("Missing from the registry: %d%s\nStale entries: %d\nWrong type flags: %d%s\n",
+           sizeof(result["missing"]), sizeof(result["missing"]) ? sprintf(" %O", result["missing"]) : "",
+           result["stale"], sizeof(result["wrong_type"]),
+           sizeof(result["wrong_type"]) ? sprintf(" %O", result["wrong_type"]) : "");
+      return;
+   }
 
    /* filter out those without the requested minimum number of instances.
       defaults to 2 or more (meaning cloned obs) */
    if (!args[0])
       args[0] = 1;
+   counts = map(REGISTRY_D->query_clone_counts(), ( : $2 + (find_object($1) ? 1 : 0) :));
    counts = filter(counts, ( : $2 > $(args[0]) :));
 
    out(sprintf("%O\n", counts));
@@ -6,7 +6,7 @@ private
 void main(string str)
 {
 
-   object *smarts = filter(objects(), ( : $1->is_smart() && clonep($1) :));
+   object *smarts = REGISTRY_D->query_type("smart");
 
    printf("<bld>%-50.50s %-7.7s %-20.20s %s<res>", "Object", "Parses", "Env", "Mood");
    foreach (object s in smarts)
@@ -24,7 +24,7 @@ void main(string arg)
    arg = evaluate_path(arg);
 
    if (is_file(evaluate_path(arg) + ".c"))
-      mobs = filter_array(objects(), ( : !$1->is_body() && clonep($1) && base_name($1) == $(arg) :));
+      mobs = filter_array(REGISTRY_D->query_clones(arg), ( : !$1->is_body() :));
    else
       mobs = filter_array(objects(), ( : !$1->is_body() && clonep($1) && $1->query_name() == $(arg) :));
    write("'" + arg + "' is found in:\n---------\n");
@@ -0,0 +1,76 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** behaviour_d.c -- Keeps count of behaviour tree NPCs (see /std/behaviour)
+**
+** Trees report in when they start, when they go dormant because no player
+** has been around for a while, and when they wake up again. The daemon
+** only keeps the books; it never drives a tree itself.
+*/
+
+private
+nosave mapping trees = ([]);
+
+private
+nosave int stat_sleeps, stat_wakes;
+
+//: FUNCTION set_tree_dormant
+// Called by a behaviour tree NPC to record whether it is currently dormant.
+void set_tree_dormant(int dormant)
+{
+   object tree = previous_object();
+
+   if (!tree->is_smart())
+      return;
+   if (trees[tree] == (dormant ? 2 : 1))
+      return;
+   if (!undefinedp(trees[tree]))
+   {
+      if (dormant)
+         stat_sleeps++;
+      else
+         stat_wakes++;
+   }
+   trees[tree] = dormant ? 2 : 1;
+}
+
+//: FUNCTION query_counts
+// Returns ([ "active" : n, "dormant" : n ]) for the trees that still exist.
+mapping query_counts()
+{
+   int active, dormant;
+
+   trees = filter(trees, ( : objectp($1) :));
+   foreach (object tree, int state in trees)
+   {
+      if (state == 2)
+         dormant++;
+      else
+         active++;
+   }
+   return (["active":active, "dormant":dormant]);
+}
+
+//: FUNCTION query_dormant_trees
+// Returns the NPCs whose trees are currently dormant.
+object *query_dormant_trees()
+{
+   return filter(keys(trees), ( : objectp($1) && trees[$1] == 2 :));
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+}
+
+string stat_me()
+{
+   mapping c = query_counts();
+
+   return "BEHAVIOUR_D:\n------------\n" + sprintf("Trees: %d active, %d dormant\n", c["active"], c["dormant"]) +
+          sprintf("Gone dormant %d times, woken %d times\n", stat_sleeps, stat_wakes) + "\n";
+}
@@ -12,6 +12,14 @@ inherit CLASS_LIMB;
 private
 mapping body_types = ([]);
 
+/* Body type -> the tables from compile_limb_tables(), shared by every
+ * adversary with that body.  Thrown away when the body type changes. */
+private
+nosave mapping limb_tables = ([]);
+
+#define LIMB_SETS (["vital":LIMB_VITAL, "wielding":LIMB_WIELDING, "mobile":LIMB_MOBILE, "system":LIMB_SYSTEM, \
+                    "attacking":LIMB_ATTACKING])
+
 mapping get_body(string type)
 {
    if (!undefinedp(body_types[type]))
@@ -32,6 +40,57 @@ mapping get_body_size(string type)
    return sizes;
 }
 
+//: FUNCTION compile_limb_tables
+// Works out the tables adversaries use to answer questions about their
+// limbs, from a mapping of limb -> class limb:
+//
+//   "limbs"     : every limb
+//   "vital", "wielding", "mobile", "system", "attacking"
+//               : the limbs with that flag
+//   "non_limbs" : body parts with a max_health of -1
+//   "weighted"  : ({ limbs, running total of their sizes }) for picking
+//                 a limb by size, see query_random_limb()
+//
+// The arrays are shared, so they must not be changed.
+mapping compile_limb_tables(mapping body)
+{
+   mapping tables = (["limbs":keys(body), "non_limbs":({})]);
+   string *sized = ({});
+   int *weights = ({});
+   int total;
+
+   foreach (string set in keys(LIMB_SETS))
+      tables[set] = ({});
+   foreach (string limb, class limb l in body)
+   {
+      foreach (string set, int flag in LIMB_SETS)
+         if (l.flags & flag)
+            tables[set] += ({limb});
+      if (l.max_health == -1)
+         tables["non_limbs"] += ({limb});
+      if (l.max_health > 0)
+      {
+         total += l.max_health;
+         sized += ({limb});
+         weights += ({total});
+      }
+   }
+   tables["weighted"] = ({sized, weights});
+   return tables;
+}
+
+//: FUNCTION query_limb_tables
+// Returns the tables from compile_limb_tables() for a body type, or 0 if
+// there is no such body type.  Worked out once per body type.
+mapping query_limb_tables(string type)
+{
+   if (undefinedp(body_types[type]))
+      return 0;
+   if (!limb_tables[type])
+      limb_tables[type] = compile_limb_tables(body_types[type]);
+   return limb_tables[type];
+}
+
 int body_exist(string type)
 {
    return !undefinedp(body_types[type]) ? 1 : 0;
@@ -41,6 +100,7 @@ void add_body(string body_name, mapping body_limbs)
 {
    if (body_name && body_limbs)
       body_types[body_name] = body_limbs;
+   map_delete(limb_tables, body_name);
    save_me();
 }
 
@@ -62,17 +122,20 @@ void add_limb_to_body(string bname, string limb, int new_health, int new_max, st
                                   : new_max, parent
                                   : new_parent, flags
                                   : new_flags);
+   map_delete(limb_tables, bname);
    save_me();
 }
 
 void remove_limb_from_body(string body_name, string limb_name)
 {
    map_delete(body_types[body_name], limb_name);
+   map_delete(limb_tables, body_name);
    save_me();
 }
 
 void remove_body(string body_name)
 {
    map_delete(body_types, body_name);
+   map_delete(limb_tables, body_name);
    save_me();
 }
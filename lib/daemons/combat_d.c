@@ -0,0 +1,343 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** combat_d.c -- Runs combat rounds for the PULSE_ROUND combat module
+**
+** Combatants join when they start fighting and leave when they stop.
+** Each heart_beat runs one round in every room with a fight going:
+** the room's useful inventory is taken once and shared by all the
+** combatants for target checks, combatants act in initiative order, and
+** the output of every player watching is held and sent in one piece when
+** the round is over. Rooms drop out as soon as their last fight ends, and
+** the heart_beat stops when no room is left.
+**
+** At most ROOMS_PER_BEAT rooms have their round in one heart_beat; the
+** rest go first in the next one, so with many fights going rounds come
+** less often instead of the heart_beat running out of evaluation cost.
+** Each room's round runs in its own catch, and held output is always
+** released, so an error in one fight stops neither the other fights nor
+** the watchers' output.
+**
+** Players who asked for a digest (see set_combat_digest()) get the blows
+** between other fighters summed up at the end of the round instead of a
+** line per blow. The combatants count the blows into a digest shared for
+** the room's round, and the line for bystanders is not even made if
+** everybody watching wants the digest.
+*/
+
+#include <combat_config.h>
+
+// Rooms that have their round in one heart_beat at most.
+#define ROOMS_PER_BEAT 50
+
+// What the digest calls the combat messages that aren't hits or misses.
+#define FEATS (["fatal":({"kills", "killing blow"}), "disarm":({"disarms", "disarm"}), \
+                "knockdown":({"knocks down", "knockdown"}), "knockout":({"knocks out", "knockout"})])
+
+private
+nosave mapping rooms = ([]);
+private
+nosave mapping fighting_in = ([]);
+
+/* Rooms still owed their round in this pass over the fights */
+private
+nosave object *waiting = ({});
+
+private
+nosave int stat_rounds, stat_turns, stat_digests, stat_errors, stat_carried;
+
+private
+object room_of(object who)
+{
+   return environment(who) && parser_root_environment(environment(who));
+}
+
+private
+void add_combatant(object who, object room)
+{
+   if (!rooms[room])
+      rooms[room] = ([]);
+   rooms[room][who] = 1;
+   fighting_in[who] = room;
+   set_heart_beat(1);
+}
+
+//: FUNCTION join_combat
+// Called by a combatant when it starts fighting.
+void join_combat()
+{
+   object who = previous_object();
+   object room = room_of(who);
+
+   if (room)
+      add_combatant(who, room);
+}
+
+//: FUNCTION leave_combat
+// Called by a combatant when it stops fighting.
+void leave_combat()
+{
+   object who = previous_object();
+   object room = fighting_in[who];
+
+   map_delete(fighting_in, who);
+   if (room && rooms[room])
+   {
+      map_delete(rooms[room], who);
+      if (!sizeof(rooms[room]))
+         map_delete(rooms, room);
+   }
+}
+
+private
+int compare_initiative(object a, object b)
+{
+   return b->query_initiative() - a->query_initiative();
+}
+
+private
+mapping start_digest(object *bodies)
+{
+   object *watchers = ({});
+   int full;
+
+   foreach (object body in bodies)
+   {
+      if (body->query_combat_digest() > CD_FULL)
+         watchers += ({body});
+      else
+         full++;
+   }
+   if (!sizeof(watchers))
+      return 0;
+   return (["watchers":watchers, "full":full, "pairs":([]), "order":({})]);
+}
+
+private
+string times(int n)
+{
+   switch (n)
+   {
+   case 1:
+      return "once";
+   case 2:
+      return "twice";
+   default:
+      return n + " times";
+   }
+}
+
+private
+string severity(int worst)
+{
+   switch (worst)
+   {
+   case 1..3:
+      return "lightly";
+   case 4..6:
+      return "solidly";
+   case 7..8:
+      return "hard";
+   default:
+      return "brutally";
+   }
+}
+
+private
+string pair_line(object attacker, object target, mixed *entry)
+{
+   string *parts = ({});
+   string them = target->the_short();
+
+   if (entry[CD_HITS])
+      parts += ({"hits " + them + " " + times(entry[CD_HITS]) + ", " + severity(entry[CD_WORST]) + " at worst"});
+   if (entry[CD_MISSES])
+      parts += ({"misses " + (sizeof(parts) ? "" : them + " ") + times(entry[CD_MISSES])});
+   foreach (string feat in entry[CD_FEATS])
+      parts += ({(FEATS[feat] ? FEATS[feat][0] : feat) + " " + (sizeof(parts) ? target->query_objective() : them)});
+
+   return capitalize(attacker->the_short()) + " " + format_list(parts, 0) + ".";
+}
+
+private
+string room_line(mixed *entries)
+{
+   int hits, misses;
+   mapping feats = ([]);
+   string *parts = ({});
+
+   foreach (mixed *entry in entries)
+   {
+      hits += entry[CD_HITS];
+      misses += entry[CD_MISSES];
+      foreach (string feat in entry[CD_FEATS])
+         feats[feat]++;
+   }
+   foreach (string feat, int n in feats)
+   {
+      string noun = FEATS[feat] ? FEATS[feat][1] : feat;
+
+      parts += ({n + " " + (n == 1 ? noun : noun + "s")});
+   }
+
+   return "Elsewhere in the fight, " + hits + (hits == 1 ? " blow lands" : " blows land") + " and " + misses +
+          (misses == 1 ? " misses" : " miss") + (sizeof(parts) ? ", with " + format_list(parts, 0) : "") + ".";
+}
+
+private
+void send_digest(object room, mapping digest)
+{
+   foreach (object watcher in digest["watchers"])
+   {
+      string *lines = ({});
+      mixed *entries = ({});
+      int level;
+
+      if (!watcher || room_of(watcher) != room)
+         continue;
+      level = watcher->query_combat_digest();
+      foreach (mixed *pair in digest["order"])
+      {
+         object attacker = pair[0], target = pair[1];
+
+         /* their own exchanges were shown in full */
+         if (attacker == watcher || target == watcher || !attacker || !target)
+            continue;
+         entries += ({digest["pairs"][attacker][target]});
+         if (level == CD_PAIRS)
+            lines += ({pair_line(attacker, target, entries[ < 1])});
+      }
+      if (!sizeof(entries))
+         continue;
+      if (level != CD_PAIRS)
+         lines = ({room_line(entries)});
+      tell(watcher, implode(lines, "\n"), MSG_INDENT);
+      stat_digests++;
+   }
+}
+
+private
+void play_round(object room, object *order, mapping occupants, mapping digest)
+{
+   foreach (object who in order)
+   {
+      if (who)
+         who->combat_round(occupants, digest);
+   }
+   if (digest)
+      send_digest(room, digest);
+}
+
+private
+void run_round(object room)
+{
+   mapping fighters = rooms[room];
+   mapping occupants = ([]);
+   object *order = ({});
+   object *bodies, *links;
+   mapping digest;
+
+   foreach (object who in keys(fighters))
+   {
+      object where;
+
+      if (!who || !who->is_attacking())
+      {
+         map_delete(fighters, who);
+         map_delete(fighting_in, who);
+         continue;
+      }
+      where = room_of(who);
+      if (where != room)
+      {
+         // Fled or followed someone; fights there from the next round
+         map_delete(fighters, who);
+         if (where)
+            add_combatant(who, where);
+         continue;
+      }
+      order += ({who});
+   }
+   if (!sizeof(fighters))
+      map_delete(rooms, room);
+   if (!sizeof(order))
+      return;
+
+   foreach (object ob in deep_useful_inv(room))
+      occupants[ob] = 1;
+   order = sort_array(order, ( : compare_initiative:));
+   bodies = filter(keys(occupants), ( : $1->is_body() :));
+   links = filter(map(bodies, ( : $1->query_link() :)), ( : $1 :));
+   digest = start_digest(bodies);
+
+   links->hold_output();
+   if (catch (play_round(room, order, occupants, digest)))
+      stat_errors++;
+   /* whatever happened, the watchers get their output back */
+   links->release_output();
+
+   stat_rounds++;
+   stat_turns += sizeof(order);
+}
+
+void heart_beat()
+{
+   int i;
+
+   /* a new pass once every room has had its round */
+   if (!sizeof(waiting))
+      waiting = keys(rooms);
+
+   for (i = 0; i < sizeof(waiting) && i < ROOMS_PER_BEAT; i++)
+   {
+      object room = waiting[i];
+
+      if (!room)
+      {
+         map_delete(rooms, room);
+         continue;
+      }
+      if (rooms[room] && catch (run_round(room)))
+         stat_errors++;
+   }
+   waiting = waiting[i..];
+   stat_carried += sizeof(waiting);
+
+   if (!sizeof(rooms))
+   {
+      fighting_in = ([]);
+      waiting = ({});
+      set_heart_beat(0);
+   }
+}
+
+//: FUNCTION query_fights
+// Returns room -> combatants for every room with a fight going.
+mapping query_fights()
+{
+   mapping ret = ([]);
+
+   foreach (object room, mapping fighters in rooms)
+      ret[room] = keys(fighters);
+   return ret;
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+}
+
+string stat_me()
+{
+   int fighters;
+
+   foreach (object room, mapping f in rooms)
+      fighters += sizeof(f);
+   return sprintf("COMBAT_D:\n---------\nRooms fighting: %d, combatants: %d\nRounds run: %d, turns taken: %d\n"
+                  "Rounds put off to the next beat: %d, rounds that errored: %d\nDigests sent: %d\n\n",
+                  sizeof(rooms), fighters, stat_rounds, stat_turns, stat_carried, stat_errors, stat_digests);
+}
@@ -73,8 +73,7 @@ string mob_name(string basename)
 
 int spawn_allowed(string basename)
 {
-   // The class is instance #1, the following are alive objects.
-   int instances = 1;
+   int instances;
    int spawn;
    // We are not under supervision, spawn away!
    if (!mapp(spawn_control[basename]))
@@ -83,9 +82,7 @@ int spawn_allowed(string basename)
    if (!intp(spawn_control[basename]["max"]))
       return 1;
 
-   // Expensive call, so doing this as late as possible.
-   instances = sizeof(filter_array(objects(), ( : base_name($1) == $(basename) :))) - 1;
-   instances = instances < 0 ? 0 : instances;
+   instances = REGISTRY_D->query_clone_count(basename);
 
    spawn = (instances >= spawn_control[basename]["max"] ? 0 : 1);
    if (spawn)
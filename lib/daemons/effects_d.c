@@ -0,0 +1,137 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** effects_d.c -- Schedules living effects (see /std/living/effects.c)
+**
+** Every pending effect on every living sits in one min-heap keyed by the
+** time it is next due, and the daemon keeps a single call_out for the
+** earliest of them. When an effect comes due the owning living's
+** run_effect() is called with the handle; the living decides whether to
+** schedule it again.
+**
+** The heap and the handles are nosave. A reloaded daemon asks every living
+** to schedule its live effects again, so they get fresh handles.
+*/
+
+inherit M_HEAP;
+
+// The most effects run from one call_out; the rest follow immediately.
+#define MAX_FIRED 200
+
+private
+nosave mapping owners = ([]);
+private
+nosave int next_handle;
+private
+nosave int timer_tag;
+private
+nosave int timer_due;
+
+private
+void rearm()
+{
+   int due = heap_peek_key();
+
+   if (!heap_size())
+   {
+      if (timer_tag)
+         remove_call_out(timer_tag);
+      timer_tag = 0;
+      timer_due = 0;
+      return;
+   }
+   if (timer_tag && due == timer_due)
+      return;
+   if (timer_tag)
+      remove_call_out(timer_tag);
+   timer_due = due;
+   timer_tag = call_out("fire_effects", due > time() ? due - time() : 0);
+}
+
+//: FUNCTION schedule_effect
+// Schedule an effect for the calling living at the given time. Returns the
+// handle to use with cancel_effect(). Passing an existing handle moves that
+// effect instead of creating a new one.
+varargs int schedule_effect(int due, int handle)
+{
+   object who = previous_object();
+
+   if (handle && owners[handle] != who)
+      error("schedule_effect: handle belongs to another object\n");
+   if (!handle)
+      handle = ++next_handle;
+   if (due <= time())
+      due = time() + 1;
+
+   owners[handle] = who;
+   heap_insert(handle, due);
+   rearm();
+   return handle;
+}
+
+//: FUNCTION cancel_effect
+// Drop a pending effect. Only the living that owns it may do this.
+int cancel_effect(int handle)
+{
+   if (owners[handle] != previous_object())
+      return 0;
+   map_delete(owners, handle);
+   heap_remove(handle);
+   rearm();
+   return 1;
+}
+
+//: FUNCTION query_effect_due
+// Returns the time the effect is due, or 0 if it is not pending.
+int query_effect_due(int handle)
+{
+   return heap_key(handle);
+}
+
+void fire_effects()
+{
+   int now = time();
+   int fired;
+
+   timer_tag = 0;
+   timer_due = 0;
+   while (heap_size() && heap_peek_key() <= now && fired++ < MAX_FIRED)
+   {
+      int handle = heap_pop();
+      object who = owners[handle];
+
+      if (!who)
+      {
+         map_delete(owners, handle);
+         continue;
+      }
+      // The living reschedules the same handle if the effect repeats.
+      if (catch (who->run_effect(handle)) || !heap_contains(handle))
+         map_delete(owners, handle);
+   }
+   rearm();
+}
+
+//: FUNCTION query_pending_effects
+// Number of effects waiting to run across the whole mud.
+int query_pending_effects()
+{
+   return heap_size();
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+   foreach (object living in REGISTRY_D->query_type("living"))
+      catch (living->reschedule_effects());
+}
+
+string stat_me()
+{
+   return sprintf("EFFECTS_D:\n----------\nPending effects: %d\nNext due in: %s\n\n", heap_size(),
+                  heap_size() ? (heap_peek_key() - time()) + "s" : "-");
+}
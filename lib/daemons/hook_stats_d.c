@@ -0,0 +1,73 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** hook_stats_d.c -- Counts the hooks run across the mud, per tag
+**
+** With HOOK_STATS defined in config.h, every call_hooks() that runs hooks
+** reports its tag and the eval cost it took, so the expensive tags can be
+** found. Calls for tags without hooks are not counted. Nothing is kept
+** when HOOK_STATS is off.
+*/
+
+private
+nosave mapping calls = ([]);
+private
+nosave mapping cost = ([]);
+private
+nosave int since = time();
+
+//: FUNCTION hooks_called
+// Called by call_hooks() in OBJECT when HOOK_STATS is defined.
+void hooks_called(string tag, int used)
+{
+   calls[tag]++;
+   if (used > 0)
+      cost[tag] += used;
+}
+
+//: FUNCTION query_hook_stats
+// Returns ([ tag : ({ calls, eval cost }) ]) since the counts were last
+// cleared.
+mapping query_hook_stats()
+{
+   mapping stats = ([]);
+
+   foreach (string tag, int n in calls)
+      stats[tag] = ({n, cost[tag]});
+   return stats;
+}
+
+//: FUNCTION clear_hook_stats
+// Start counting again.
+void clear_hook_stats()
+{
+   if (!check_privilege(1))
+      error("Insufficient privilege to clear hook stats.\n");
+   calls = ([]);
+   cost = ([]);
+   since = time();
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+}
+
+string stat_me()
+{
+   string ret = "HOOK_STATS_D:\n-------------\n";
+   string *tags = sort_array(keys(calls), ( : $(cost)[$2] - $(cost)[$1] :));
+
+#ifndef HOOK_STATS
+   ret += "HOOK_STATS is not defined in config.h, so nothing is counted.\n";
+#endif
+   ret += sprintf("Counting for %d seconds\n", time() - since);
+   foreach (string tag in tags)
+      ret += sprintf("  %-24s %8d calls %12d eval cost %8d per call\n", tag, calls[tag], cost[tag],
+                     cost[tag] / calls[tag]);
+   return ret + "\n";
+}
@@ -141,7 +141,7 @@ void drop_corpse(object adversary)
       all_inventory(adversary)->set_worn(0);
       all_inventory(adversary)->set_tattered();
       all_inventory(adversary)->reduce_value_by(10);
-      all_inventory(adversary)->move(corpse);
+      move_many(all_inventory(adversary), corpse);
 #endif
       corpse->move(environment(adversary));
       adversary->move(stone_room);
@@ -157,7 +157,7 @@ void drop_corpse(object adversary)
          all_inventory(adversary)->set_worn(0);
          all_inventory(adversary)->set_tattered();
          all_inventory(adversary)->reduce_value_by(10);
-         all_inventory(adversary)->move(corpse);
+         move_many(all_inventory(adversary), corpse);
          coins_treasure(adversary->query_level(), cur)->move(corpse);
       }
       if (adversary->query_drops_pelt())
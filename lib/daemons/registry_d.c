@@ -0,0 +1,271 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** registry_d.c -- Indexes the clones of mudlib objects
+**
+** Every clone of OBJECT joins from create() and leaves from remove(), so
+** questions like "how many orcs are out there" or "where are the livings"
+** can be answered without walking objects(). Three indexes are kept:
+**
+**   base_name -> clones
+**   domain    -> base_names with clones (domain counts are summed from these)
+**   type      -> clones, for the types in TYPES
+**
+** Blueprints are not indexed; find_object() already finds those. Objects
+** destructed without remove() being called linger as dead keys until the
+** next purge, which runs every PURGE_INTERVAL seconds. verify() compares
+** the registry against objects().
+*/
+
+// Type name -> the function that marks an object of that type.
+#define TYPES (["living":"is_living", "body":"is_body", "weapon":"is_weapon", "armor":"is_armor", \
+                "container":"is_container", "smart":"is_smart", "stateful":"is_stateful"])
+
+#define PURGE_INTERVAL 900
+
+private
+nosave mapping clones = ([]);
+private
+nosave mapping domain_bases = ([]);
+private
+nosave mapping types = ([]);
+private
+nosave mapping base_types = ([]);
+
+private
+nosave int stat_joins, stat_leaves, stat_purged;
+
+//: FUNCTION domain_of
+// The domain an object file belongs to: the directory below /domains for
+// domain code, otherwise the top level directory ("std", "obj", "wiz" ...).
+string domain_of(string base)
+{
+   string *parts = explode(base, "/");
+
+   if (sizeof(parts) > 2 && parts[0] == "domains")
+      return parts[1];
+   return sizeof(parts) > 1 ? parts[0] : "";
+}
+
+private
+string *types_of(object ob, string base)
+{
+   string *found;
+
+   if (found = base_types[base])
+      return found;
+   found = ({});
+   foreach (string type, string fn in TYPES)
+      if (call_other(ob, fn))
+         found += ({type});
+   return base_types[base] = found;
+}
+
+//: FUNCTION join
+// Called from OBJECT's create(). Clones are indexed; a blueprint joining
+// means the file was (re)compiled, so its type flags are worked out again.
+void join()
+{
+   object ob = previous_object();
+   string base = base_name(ob);
+   string domain;
+
+   if (!clonep(ob))
+   {
+      map_delete(base_types, base);
+      return;
+   }
+   stat_joins++;
+   if (!clones[base])
+   {
+      clones[base] = ([]);
+      domain = domain_of(base);
+      if (!domain_bases[domain])
+         domain_bases[domain] = ([]);
+      domain_bases[domain][base] = 1;
+   }
+   clones[base][ob] = 1;
+
+   foreach (string type in types_of(ob, base))
+   {
+      if (!types[type])
+         types[type] = ([]);
+      types[type][ob] = 1;
+   }
+}
+
+private
+void drop_base_if_empty(string base)
+{
+   string domain;
+
+   if (sizeof(clones[base]))
+      return;
+   map_delete(clones, base);
+   domain = domain_of(base);
+   if (domain_bases[domain])
+   {
+      map_delete(domain_bases[domain], base);
+      if (!sizeof(domain_bases[domain]))
+         map_delete(domain_bases, domain);
+   }
+}
+
+//: FUNCTION leave
+// Called from remove() when an object is destructed.
+void leave()
+{
+   object ob = previous_object();
+   string base = base_name(ob);
+
+   if (!clonep(ob) || !clones[base] || !clones[base][ob])
+      return;
+   stat_leaves++;
+   map_delete(clones[base], ob);
+   drop_base_if_empty(base);
+   foreach (string type, mapping obs in types)
+      map_delete(obs, ob);
+}
+
+//: FUNCTION purge
+// Drop objects that were destructed without calling remove().
+void purge()
+{
+   int before, after;
+
+   foreach (string base in keys(clones))
+   {
+      before += sizeof(clones[base]);
+      clones[base] = filter(clones[base], ( : objectp($1) :));
+      after += sizeof(clones[base]);
+      drop_base_if_empty(base);
+   }
+   foreach (string type in keys(types))
+      types[type] = filter(types[type], ( : objectp($1) :));
+   stat_purged += before - after;
+   call_out("purge", PURGE_INTERVAL);
+}
+
+//: FUNCTION query_clone_count
+// Number of clones of the given file.
+int query_clone_count(string base)
+{
+   return clones[base] ? sizeof(clones[base]) : 0;
+}
+
+//: FUNCTION query_clones
+// The clones of the given file.
+object *query_clones(string base)
+{
+   return clones[base] ? filter(keys(clones[base]), ( : objectp :)) : ({});
+}
+
+//: FUNCTION query_clone_counts
+// Mapping of file -> number of clones, for every file with clones.
+mapping query_clone_counts()
+{
+   return map(clones, ( : sizeof($2) :));
+}
+
+//: FUNCTION query_domain_count
+// Number of clones of files in the given domain. See domain_of().
+int query_domain_count(string domain)
+{
+   int count;
+
+   if (domain_bases[domain])
+      foreach (string base in keys(domain_bases[domain]))
+         count += sizeof(clones[base]);
+   return count;
+}
+
+//: FUNCTION query_domain_counts
+// Mapping of domain -> number of clones.
+mapping query_domain_counts()
+{
+   mapping counts = ([]);
+
+   foreach (string domain in keys(domain_bases))
+      counts[domain] = query_domain_count(domain);
+   return counts;
+}
+
+//: FUNCTION query_type
+// The clones of the given type, see TYPES for the types kept.
+object *query_type(string type)
+{
+   return types[type] ? filter(keys(types[type]), ( : objectp :)) : ({});
+}
+
+int query_type_count(string type)
+{
+   return types[type] ? sizeof(types[type]) : 0;
+}
+
+string *query_types()
+{
+   return keys(TYPES);
+}
+
+//: FUNCTION verify
+// Compare the registry with objects(). Returns ([ "missing" : clones of
+// OBJECT that are not registered, "stale" : how many registered entries
+// are no longer loaded, "wrong_type" : registered objects whose type flags
+// changed ]). Nothing missing or wrong means the registry is consistent;
+// stale entries are harmless and go at the next purge(). This walks the
+// whole heap, so it is for testing and debugging only.
+mapping verify()
+{
+   object *missing = ({});
+   int stale;
+   object *wrong_type = ({});
+   mapping live = ([]);
+
+   foreach (object ob in objects())
+   {
+      string base;
+
+      if (!clonep(ob) || !inherits(OBJECT, ob))
+         continue;
+      base = base_name(ob);
+      live[ob] = 1;
+      if (!clones[base] || !clones[base][ob])
+         missing += ({ob});
+      else
+         foreach (string type, string fn in TYPES)
+            if (!call_other(ob, fn) != !(types[type] && types[type][ob]))
+            {
+               wrong_type += ({ob});
+               break;
+            }
+   }
+   foreach (string base, mapping obs in clones)
+      foreach (object ob in keys(obs))
+         if (!ob || !live[ob])
+            stale++;
+
+   return (["missing":missing, "stale":stale, "wrong_type":wrong_type]);
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+   call_out("purge", PURGE_INTERVAL);
+}
+
+string stat_me()
+{
+   int total;
+
+   foreach (string base, mapping obs in clones)
+      total += sizeof(obs);
+   return "REGISTRY_D:\n-----------\n" +
+          sprintf("Clones: %d of %d files in %d domains\n", total, sizeof(clones), sizeof(domain_bases)) +
+          sprintf("Types: %s\n",
+                  implode(map(sort_array(keys(TYPES), 1), ( : $1 + " " + query_type_count($1) :)), ", ")) +
+          sprintf("Joined %d, left %d, purged %d\n", stat_joins, stat_leaves, stat_purged) + "\n";
+}
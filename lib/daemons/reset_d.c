@@ -0,0 +1,231 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** reset_d.c -- Spreads room resets out over time
+**
+** The driver resets every object "time to reset" seconds after it was
+** loaded, so rooms loaded together at boot reset together, and every
+** reset may clone NPCs and items. Rooms hand their resets to us instead:
+**
+**  - a room with no players in it puts its reset off until a player
+**    walks in (reset on entry), and any resets it misses until then are
+**    folded into that one
+**  - a room with players in it is queued to reset up to RESET_JITTER
+**    seconds later, and at most RESETS_PER_TICK queued resets run each
+**    second
+**
+** The queue is a min-heap (M_HEAP) of due times, with one call_out for
+** the earliest. The number of resets run in each of the last
+** HISTORY_SECONDS seconds is kept for query_resets_per_second().
+*/
+
+inherit M_HEAP;
+
+// Seconds a queued reset can be put off by, chosen at random.
+#define RESET_JITTER 120
+// Queued resets run per second at most.
+#define RESETS_PER_TICK 3
+// Seconds of reset counts kept.
+#define HISTORY_SECONDS 60
+
+private
+nosave mapping handles = ([]);
+private
+nosave mapping rooms = ([]);
+private
+nosave int next_handle;
+private
+nosave int tick_tag;
+private
+nosave int tick_due;
+
+private
+nosave int *history = allocate(HISTORY_SECONDS);
+private
+nosave int *history_time = allocate(HISTORY_SECONDS);
+
+private
+nosave int stat_queued, stat_run, stat_deferred, stat_collapsed, stat_on_entry, stat_max_second;
+
+private
+void record_reset()
+{
+   int now = time();
+   int slot = now % HISTORY_SECONDS;
+
+   if (history_time[slot] != now)
+   {
+      history_time[slot] = now;
+      history[slot] = 0;
+   }
+   if (++history[slot] > stat_max_second)
+      stat_max_second = history[slot];
+   stat_run++;
+}
+
+private
+void run_reset(object room)
+{
+   catch (room->run_reset());
+   record_reset();
+}
+
+private
+void rearm(int delay)
+{
+   int due;
+
+   if (!heap_size())
+      return;
+   due = delay ? time() + delay : heap_peek_key();
+   if (tick_tag && due >= tick_due)
+      return;
+   if (tick_tag)
+      remove_call_out(tick_tag);
+   tick_due = due;
+   tick_tag = call_out("process_resets", due > time() ? due - time() : 0);
+}
+
+private
+void unqueue(object room)
+{
+   int handle = handles[room];
+
+   map_delete(handles, room);
+   map_delete(rooms, handle);
+   heap_remove(handle);
+}
+
+//: FUNCTION process_resets
+// Runs the resets that are due, up to RESETS_PER_TICK of them.
+void process_resets()
+{
+   int budget = RESETS_PER_TICK;
+   object room;
+
+   tick_tag = 0;
+   while (heap_size() && heap_peek_key() <= time())
+   {
+      if (!budget--)
+      {
+         /* The rest wait for the next second */
+         rearm(1);
+         return;
+      }
+      room = rooms[heap_peek()];
+      if (!room)
+      {
+         /* Unloaded while it waited */
+         map_delete(rooms, heap_pop());
+         continue;
+      }
+      unqueue(room);
+      run_reset(room);
+   }
+   rearm(0);
+}
+
+//: FUNCTION schedule_reset
+// Called by a room with players in it when the driver resets it. The
+// reset runs within RESET_JITTER seconds.
+void schedule_reset()
+{
+   object room = previous_object();
+   int handle;
+
+   if (handles[room])
+   {
+      stat_collapsed++;
+      return;
+   }
+   handle = ++next_handle;
+   handles[room] = handle;
+   rooms[handle] = room;
+   heap_insert(handle, time() + random(RESET_JITTER));
+   stat_queued++;
+   rearm(0);
+}
+
+//: FUNCTION reset_deferred
+// Called by a room with nobody in it when the driver resets it. The room
+// remembers that it owes a reset and calls reset_on_entry() when a player
+// arrives; already_owed says it owed one before, so this one is folded in.
+void reset_deferred(int already_owed)
+{
+   if (already_owed)
+      stat_collapsed++;
+   else
+      stat_deferred++;
+}
+
+//: FUNCTION reset_on_entry
+// Called by a room that owes a reset when a player walks in. The reset
+// runs straight away, and replaces any queued one.
+void reset_on_entry()
+{
+   object room = previous_object();
+
+   if (handles[room])
+   {
+      unqueue(room);
+      stat_collapsed++;
+   }
+   stat_on_entry++;
+   run_reset(room);
+}
+
+//: FUNCTION query_resets_per_second
+// Returns the number of resets run in each of the last HISTORY_SECONDS
+// seconds, oldest first.
+int *query_resets_per_second()
+{
+   int now = time();
+   int *counts = allocate(HISTORY_SECONDS);
+
+   for (int i = 0; i < HISTORY_SECONDS; i++)
+   {
+      int t = now - HISTORY_SECONDS + 1 + i;
+      int slot = t % HISTORY_SECONDS;
+
+      if (history_time[slot] == t)
+         counts[i] = history[slot];
+   }
+   return counts;
+}
+
+//: FUNCTION query_stats
+// Returns the counters shown by stat_me() as a mapping.
+mapping query_stats()
+{
+   return (["queued":stat_queued, "run":stat_run, "deferred":stat_deferred, "collapsed":stat_collapsed,
+            "on_entry":stat_on_entry, "max_second":stat_max_second, "waiting":heap_size()]);
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+}
+
+string stat_me()
+{
+   mapping buckets = ([]);
+   string hist = "";
+
+   /* How many of the last seconds saw how many resets */
+   foreach (int n in query_resets_per_second())
+      buckets[n]++;
+   foreach (int n in sort_array(keys(buckets), 1))
+      hist += sprintf("  %3d resets/sec: %d\n", n, buckets[n]);
+
+   return "RESET_D:\n--------\n" +
+          sprintf("Waiting: %d, jitter %d seconds, at most %d per second\n", heap_size(), RESET_JITTER,
+                  RESETS_PER_TICK) +
+          sprintf("Queued %d, deferred %d, on entry %d, collapsed %d, run %d\n", stat_queued, stat_deferred,
+                  stat_on_entry, stat_collapsed, stat_run) +
+          sprintf("Most resets in one second: %d\n", stat_max_second) +
+          sprintf("Last %d seconds:\n%s", HISTORY_SECONDS, hist) + "\n";
+}
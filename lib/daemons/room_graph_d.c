@@ -0,0 +1,648 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** room_graph_d.c -- An index of the rooms on the MUD and how they connect
+**
+** Every room is a node with its exits (direction -> destination), the
+** exits that are doors, and its areas (see set_area()). Rooms are indexed
+** in two ways:
+**
+**  - from source: the room's .c file is read and literal set_exits(),
+**    add_exit() and set_area() calls are picked out. Nothing is loaded.
+**    Rooms whose exits are computed are left for the second way.
+**  - when loaded: every room reports itself from create(), so a recompiled
+**    room replaces what was known about it. Doors are only learned here.
+**
+** The graph is saved, so it survives reboots. Routes are found with a
+** breadth first search (rooms have no coordinates to guide an A* search,
+** and every exit costs the same), and recent routes are kept in an LRU
+** cache that is emptied whenever an exit or door changes; a change of
+** areas only drops the routes kept for a list of areas.
+*/
+
+inherit M_DAEMON_DATA;
+
+// Files read per call_out while scanning a directory.
+#define SCAN_BATCH 20
+// Rooms a route search looks at before giving up.
+#define MAX_SEARCH 5000
+// Routes kept in the cache.
+#define ROUTE_CACHE_SIZE 256
+// Seconds to gather changes before the graph is saved.
+#define SAVE_DELAY 60
+
+#define FROM_SOURCE 1
+#define FROM_OBJECT 2
+
+private
+mapping exits = ([]);
+private
+mapping doors = ([]);
+private
+mapping areas = ([]);
+private
+mapping origin = ([]);
+
+private
+nosave mapping unparsable = ([]);
+private
+nosave string *scan_queue = ({});
+private
+nosave int scan_tag;
+private
+nosave int save_tag;
+private
+nosave mapping route_cache = ([]);
+private
+nosave mapping route_used = ([]);
+private
+nosave int route_tick;
+private
+nosave int stat_hits, stat_misses, stat_searches, stat_unparsed;
+
+private
+void changed()
+{
+   if (!save_tag)
+      save_tag = call_out("save_graph", SAVE_DELAY);
+}
+
+void save_graph()
+{
+   save_tag = 0;
+   save_me();
+}
+
+private
+void flush_routes()
+{
+   route_cache = ([]);
+   route_used = ([]);
+}
+
+/* Drop the routes that were kept to a list of areas, see find_route() */
+private
+void flush_area_routes()
+{
+   foreach (string key in keys(route_cache))
+      if (sizeof(explode(key, "\n")) > 2)
+      {
+         map_delete(route_cache, key);
+         map_delete(route_used, key);
+      }
+}
+
+private
+string room_name(string path)
+{
+   if (path[ < 2..] == ".c")
+      return path[0.. < 3];
+   return path;
+}
+
+private
+int same_exits(mapping a, mapping b)
+{
+   if (!a || !b || sizeof(a) != sizeof(b))
+      return 0;
+   foreach (string dir, string dest in a)
+      if (b[dir] != dest)
+         return 0;
+   return 1;
+}
+
+private
+int same_list(string *a, string *b)
+{
+   if (!a || !b || sizeof(a) != sizeof(b))
+      return 0;
+   return !sizeof(a - b) && !sizeof(b - a);
+}
+
+private
+void set_node(string room, mapping room_exits, string *room_doors, string *room_areas, int how)
+{
+   int new_exits = !same_exits(exits[room], room_exits);
+   int new_doors = !same_list(doors[room], room_doors);
+   int new_areas = !same_list(areas[room], room_areas);
+
+   if (!new_exits && !new_doors && !new_areas && origin[room] == how)
+      return;
+   if (new_exits || new_doors)
+      flush_routes();
+   else if (new_areas)
+      flush_area_routes();
+   exits[room] = room_exits;
+   doors[room] = room_doors;
+   areas[room] = room_areas;
+   origin[room] = how;
+   changed();
+}
+
+private
+void add_room(object room)
+{
+   mapping room_exits = ([]);
+   string *room_doors = ({});
+   string dest;
+   object exit_ob;
+
+   if (!room || clonep(room))
+      return;
+   map_delete(unparsable, file_name(room));
+
+   foreach (string dir in room->query_exit_directions(1))
+   {
+      dest = room->query_exit_destination(dir);
+      if (!stringp(dest) || dest == "" || dest[0] == '#')
+         continue;
+      room_exits[dir] = room_name(dest);
+      exit_ob = present(dir, room);
+      if (exit_ob && exit_ob->is_exit() && function_exists("query_closed", exit_ob))
+         room_doors += ({dir});
+   }
+   set_node(file_name(room), room_exits, room_doors, room->query_area() || ({}), FROM_OBJECT);
+}
+
+//: FUNCTION index_room
+// Record the exits and areas of a loaded room. Rooms call this from
+// create(), so recompiling a room keeps the graph up to date.
+void index_room(object room)
+{
+   if (previous_object() != room && !check_privilege(1))
+      error("Insufficient privilege to index rooms.\n");
+   add_room(room);
+}
+
+//: FUNCTION forget_room
+// Drop a room from the graph, e.g. when its file is removed.
+void forget_room(string room)
+{
+   if (!check_privilege(1))
+      error("Insufficient privilege to forget rooms.\n");
+   room = room_name(room);
+   if (undefinedp(exits[room]))
+      return;
+   map_delete(exits, room);
+   map_delete(doors, room);
+   map_delete(areas, room);
+   map_delete(origin, room);
+   flush_routes();
+   changed();
+}
+
+/*
+** Source parsing
+*/
+
+// Returns the text between the parenthesis at src[pos] and its match, or 0.
+private
+string call_args(string src, int pos)
+{
+   int depth, len = strlen(src);
+
+   for (int i = pos; i < len; i++)
+   {
+      switch (src[i])
+      {
+      case '"':
+         for (i++; i < len && src[i] != '"'; i++)
+            if (src[i] == '\\')
+               i++;
+         break;
+      case '(':
+         depth++;
+         break;
+      case ')':
+         if (!--depth)
+            return src[pos + 1..i - 1];
+         break;
+      }
+   }
+   return 0;
+}
+
+// Splits text made only of string literals and separators into the
+// literals. seps[n] is the separator expected after the nth literal,
+// cycling. Returns 0 if anything else turns up.
+private
+string *literals(string text, string *seps)
+{
+   string *found = ({});
+   string gap;
+   int len = strlen(text);
+   int gap_start, start;
+
+   for (int i = 0; i < len; i++)
+   {
+      if (text[i] != '"')
+         continue;
+      gap = trim(text[gap_start..i - 1]);
+      if (sizeof(found) ? gap != seps[(sizeof(found) - 1) % sizeof(seps)] : gap != "")
+         return 0;
+      start = i + 1;
+      for (i = start; i < len && text[i] != '"'; i++)
+         if (text[i] == '\\')
+            return 0;
+      if (i == len)
+         return 0;
+      found += ({text[start..i - 1]});
+      gap_start = i + 1;
+   }
+   gap = trim(text[gap_start..]);
+   if (gap != "" && gap != ",")
+      return 0;
+   return found;
+}
+
+// Returns the argument text of every call to fname() in src.
+private
+string *calls_to(string src, string fname)
+{
+   string *args = ({});
+   string arg;
+   int pos = 0, at;
+
+   while ((at = strsrch(src[pos..], fname + "(")) != -1)
+   {
+      pos += at;
+      // Skip longer names ending in fname, like my_set_exits(
+      if (pos && (src[pos - 1] == '_' || (src[pos - 1] >= 'a' && src[pos - 1] <= 'z')))
+      {
+         pos += strlen(fname);
+         continue;
+      }
+      pos += strlen(fname);
+      if (!(arg = call_args(src, pos)))
+         return 0;
+      args += ({arg});
+      pos += strlen(arg) + 2;
+   }
+   return args;
+}
+
+//: FUNCTION scan_room
+// Index a room from its source file without loading it. Returns 1 if the
+// room could be indexed. Rooms already known from a loaded object are left
+// alone.
+int scan_room(string file)
+{
+   string src, dir;
+   string *calls, *lits;
+   mapping room_exits = ([]);
+   string *room_areas = ({});
+   string room;
+
+   room = room_name(file);
+   if (origin[room] == FROM_OBJECT && find_object(room))
+      return 1;
+   if (unparsable[room] || !(src = read_file(room + ".c")))
+      return 0;
+   // Until we know better.
+   unparsable[room] = 1;
+   dir = room[0..strsrch(room, '/', -1) - 1];
+
+   if (!(calls = calls_to(src, "set_exits")))
+      return 0;
+   foreach (string arg in calls)
+   {
+      arg = trim(arg);
+      if (arg[0..1] != "([" || arg[ < 2..] != "])" || !(lits = literals(arg[2.. < 3], ({":", ","}))) ||
+          sizeof(lits) % 2)
+      {
+         stat_unparsed++;
+         return 0;
+      }
+      for (int i = 0; i < sizeof(lits); i += 2)
+         room_exits[lits[i]] = lits[i + 1];
+   }
+
+   if (!(calls = calls_to(src, "add_exit")))
+      return 0;
+   foreach (string arg in calls)
+   {
+      if (!(lits = literals(arg, ({","}))) || sizeof(lits) != 2)
+      {
+         stat_unparsed++;
+         return 0;
+      }
+      room_exits[lits[0]] = lits[1];
+   }
+
+   if (!(calls = calls_to(src, "set_area")))
+      return 0;
+   foreach (string arg in calls)
+   {
+      if (!(lits = literals(arg, ({","}))))
+      {
+         stat_unparsed++;
+         return 0;
+      }
+      // Like set_area(), the last call wins.
+      room_areas = lits;
+   }
+
+   foreach (string exit_dir, string dest in room_exits)
+   {
+      if (dest == "" || dest[0] == '#')
+         map_delete(room_exits, exit_dir);
+      else
+         room_exits[exit_dir] = room_name(absolute_path(dest, dir));
+   }
+   map_delete(unparsable, room);
+   set_node(room, room_exits, ({}), room_areas, FROM_SOURCE);
+   return 1;
+}
+
+private
+void queue_directory(string path)
+{
+   mixed *files = get_dir(path + "*", -1);
+
+   if (!files)
+      return;
+   foreach (mixed *info in files)
+   {
+      if (info[1] == -2)
+      {
+         if (info[0] != "." && info[0] != "..")
+            queue_directory(path + info[0] + "/");
+      }
+      else if (info[0][ < 2..] == ".c")
+         scan_queue += ({path + info[0]});
+   }
+}
+
+void scan_batch()
+{
+   string file, src;
+
+   scan_tag = 0;
+   for (int i = 0; i < SCAN_BATCH && sizeof(scan_queue); i++)
+   {
+      file = scan_queue[0];
+      scan_queue = scan_queue[1..];
+      src = read_file(file);
+      // Only files that look like rooms.
+      if (src && (strsrch(src, "set_exits(") != -1 || strsrch(src, "add_exit(") != -1))
+         scan_room(file);
+   }
+   if (sizeof(scan_queue))
+      scan_tag = call_out("scan_batch", 1);
+}
+
+//: FUNCTION scan_directory
+// Index every room below a directory from source, a few files per
+// call_out. Returns the number of files queued.
+int scan_directory(string path)
+{
+   int before = sizeof(scan_queue);
+
+   if (!check_privilege(1))
+      error("Insufficient privilege to scan directories.\n");
+   if (path[ < 1] != '/')
+      path += "/";
+   queue_directory(path);
+   if (!scan_tag && sizeof(scan_queue))
+      scan_tag = call_out("scan_batch", 1);
+   return sizeof(scan_queue) - before;
+}
+
+/*
+** Queries
+*/
+
+// Make sure the room is in the graph. If may_load is set, rooms that can
+// not be indexed from source are loaded as a last resort.
+private
+int known(string room, int may_load)
+{
+   object ob;
+
+   if (!undefinedp(exits[room]))
+      return 1;
+   if (ob = find_object(room))
+      add_room(ob);
+   else if (!scan_room(room) && may_load && (ob = load_object(room)))
+      add_room(ob);
+   return !undefinedp(exits[room]);
+}
+
+//: FUNCTION room_exists
+// Returns 1 if the room is in the graph, indexing it if needed.
+int room_exists(string room)
+{
+   return stringp(room) && known(room_name(room), 1);
+}
+
+//: FUNCTION query_room_exits
+// Returns the exits of a room as direction -> destination, or 0.
+mapping query_room_exits(string room)
+{
+   room = room_name(room);
+   return known(room, 1) ? copy(exits[room]) : 0;
+}
+
+//: FUNCTION query_room_doors
+// Returns the directions of a room's exits that are doors, as far as is
+// known. Doors are only seen once the room has been loaded.
+string *query_room_doors(string room)
+{
+   room = room_name(room);
+   return known(room, 1) ? doors[room] : 0;
+}
+
+//: FUNCTION query_room_areas
+// Returns the areas of a room (see set_area()), or 0 for an unknown room.
+string *query_room_areas(string room)
+{
+   room = room_name(room);
+   return known(room, 1) ? areas[room] : 0;
+}
+
+//: FUNCTION room_in_area
+// Returns 1 if the room belongs to one of the given areas, 0 if it does
+// not and -1 if there is no such room. Used for wander restrictions.
+int room_in_area(string room, string *area_list)
+{
+   room = room_name(room);
+   if (!known(room, 1))
+      return -1;
+   return sizeof(areas[room] & area_list) ? 1 : 0;
+}
+
+private
+string room_dir(string room)
+{
+   return room[0..strsrch(room, '/', -1)];
+}
+
+/*
+** Whether a route may pass through the room. A room that hasn't been
+** indexed yet, or has no areas, is taken to be in the area if it lives in
+** the same directory as a room of the area the search has been through.
+*/
+private
+int passable(string room, string *area_list, mapping area_dirs)
+{
+   if (sizeof(areas[room]))
+      return sizeof(areas[room] & area_list) ? 1 : 0;
+   return area_dirs[room_dir(room)] ? 1 : 0;
+}
+
+private
+string *search(string from, string to, string *area_list)
+{
+   string *frontier = allocate(MAX_SEARCH);
+   mapping came_from = ([from:0]);
+   mapping area_dirs = ([]);
+   int head, tail;
+
+   stat_searches++;
+   frontier[tail++] = from;
+   while (head < tail)
+   {
+      string room = frontier[head++];
+
+      if (room == to)
+      {
+         string *route = ({});
+
+         while (came_from[room])
+         {
+            route = ({came_from[room][1]}) + route;
+            room = came_from[room][0];
+         }
+         return route;
+      }
+      if (!known(room, 0))
+         continue;
+      if (area_list && sizeof(areas[room] & area_list))
+         area_dirs[room_dir(room)] = 1;
+      foreach (string dir, string dest in exits[room])
+      {
+         if (!undefinedp(came_from[dest]))
+            continue;
+         // The goal may be outside the area; nothing else may be.
+         if (area_list && dest != to && !passable(dest, area_list, area_dirs))
+            continue;
+         // Rooms past MAX_SEARCH would never be looked at
+         if (tail == MAX_SEARCH)
+            break;
+         came_from[dest] = ({room, dir});
+         frontier[tail++] = dest;
+      }
+   }
+   return 0;
+}
+
+private
+void cache_route(string key, string *route)
+{
+   if (sizeof(route_cache) >= ROUTE_CACHE_SIZE)
+   {
+      string oldest;
+      int oldest_tick;
+
+      foreach (string k, int tick in route_used)
+         if (!oldest || tick < oldest_tick)
+         {
+            oldest = k;
+            oldest_tick = tick;
+         }
+      map_delete(route_cache, oldest);
+      map_delete(route_used, oldest);
+   }
+   route_cache[key] = route;
+   route_used[key] = ++route_tick;
+}
+
+//: FUNCTION find_route
+// Returns the directions to take to get from one room to another, ({})
+// when they are the same room, or 0 if there is no known way. If area_list
+// is given, the route only passes through rooms in those areas. Routes to
+// rooms only found from source may not be walkable if an exit is blocked.
+varargs string *find_route(string from, string to, string *area_list)
+{
+   string key;
+   string *route;
+
+   if (!from || !to)
+      return 0;
+   from = room_name(from);
+   to = room_name(to);
+   key = from + "\n" + to + (area_list ? "\n" + implode(sort_array(area_list, 1), ",") : "");
+
+   if (!undefinedp(route_cache[key]))
+   {
+      stat_hits++;
+      route_used[key] = ++route_tick;
+      return route_cache[key] && copy(route_cache[key]);
+   }
+   stat_misses++;
+   route = search(from, to, area_list);
+   cache_route(key, route);
+   return route && copy(route);
+}
+
+//: FUNCTION next_step
+// Returns the first direction of find_route(), or 0.
+varargs string next_step(string from, string to, string *area_list)
+{
+   string *route = find_route(from, to, area_list);
+
+   return sizeof(route) ? route[0] : 0;
+}
+
+mapping query_stats()
+{
+   int from_source;
+
+   foreach (string room, int how in origin)
+      if (how == FROM_SOURCE)
+         from_source++;
+   return ([
+       "rooms":sizeof(exits),
+       "from_source":from_source,
+       "unparsed":stat_unparsed,
+       "scan_queue":sizeof(scan_queue),
+       "cached_routes":sizeof(route_cache),
+       "searches":stat_searches,
+       "hits":stat_hits,
+       "misses":stat_misses,
+   ]);
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+   ::create();
+   if (!sizeof(exits))
+   {
+      queue_directory("/domains/");
+      if (sizeof(scan_queue))
+         scan_tag = call_out("scan_batch", 1);
+   }
+}
+
+void remove()
+{
+   if (save_tag)
+      save_me();
+}
+
+string stat_me()
+{
+   mapping s = query_stats();
+
+   return "ROOM_GRAPH_D:\n-------------\n" +
+          sprintf("Rooms: %d (%d from source, %d files could not be parsed), %d files waiting to be scanned\n",
+                  s["rooms"], s["from_source"], s["unparsed"], s["scan_queue"]) +
+          sprintf("Routes: %d searches, %d cached, %d hits, %d misses\n", s["searches"], s["cached_routes"],
+                  s["hits"], s["misses"]) +
+          "\n";
+}
@@ -0,0 +1,278 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** room_lifecycle_d.c -- Unloads idle rooms and puts back what was in them
+**
+** Domain rooms report in from create() and are kept in least recently
+** used order; a room is used when something enters, leaves or changes in
+** it. Every SWEEP_INTERVAL seconds the rooms idle for IDLE_LIMIT seconds
+** are evicted, and while more than MAX_RESIDENT rooms are loaded the least
+** recently used rooms idle for MIN_IDLE seconds go as well. At most
+** EVICT_BATCH rooms go per sweep.
+**
+** Before a room goes, its state is kept in a snapshot:
+**
+**  - objects the room did not clone itself, such as dropped items, saved
+**    with save_to_string() from M_SAVE
+**  - whether its doors are closed and locked
+**  - its room states, see set_room_state()
+**
+** The snapshot is put back when the room is next loaded. Objects the room
+** clones itself come back from setup(), so a room is not evicted while
+** any of them, or of those cloned by containers in it, have been taken or
+** killed; it waits for its next reset to put them back, rather than
+** getting them back early by being loaded again. Rooms holding a living
+** other than their own NPCs are never evicted, and neither are rooms that
+** call set_keep_loaded(1). Snapshots are kept in
+** memory, so like everything else on the floor they don't survive a reboot,
+** and reloading this daemon loses whatever was on the floor of every room
+** it has evicted.
+*/
+
+#include <move.h>
+
+// Seconds between sweeps.
+#define SWEEP_INTERVAL 60
+// Seconds a room has to be idle before it is evicted.
+#define IDLE_LIMIT 1800
+// Rooms loaded before less idle rooms are evicted too.
+#define MAX_RESIDENT 1000
+// Seconds a room has to be idle before it is evicted to stay under MAX_RESIDENT.
+#define MIN_IDLE 120
+// Rooms evicted per sweep at most.
+#define EVICT_BATCH 25
+
+private
+nosave mapping resident = ([]);
+private
+nosave mapping snapshots = ([]);
+
+private
+nosave int stat_evicted, stat_restored, stat_restore_usecs, stat_restore_max, stat_sweeps, stat_errors;
+
+private
+void restore_snapshot(object room, string snapshot);
+
+private
+int tracked(object room)
+{
+   return !clonep(room) && strsrch(file_name(room), "/domains/") == 0;
+}
+
+//: FUNCTION room_loaded
+// Called from the create() of rooms. Starts keeping track of the room and
+// puts back its snapshot, if it has one.
+void room_loaded()
+{
+   object room = previous_object();
+   string name = file_name(room);
+   int usecs;
+
+   if (!tracked(room))
+      return;
+   resident[room] = time();
+   if (!snapshots[name])
+      return;
+
+   usecs = time_expression(restore_snapshot(room, snapshots[name]));
+   map_delete(snapshots, name);
+   stat_restored++;
+   stat_restore_usecs += usecs;
+   if (usecs > stat_restore_max)
+      stat_restore_max = usecs;
+}
+
+//: FUNCTION touch
+// Called by a room when something in it changes; it moves to the back of
+// the eviction queue.
+void touch()
+{
+   object room = previous_object();
+
+   if (resident[room])
+      resident[room] = time();
+}
+
+//: FUNCTION evictable
+// Returns 1 if the room can be unloaded without anyone noticing.
+int evictable(object room)
+{
+   if (!room || !tracked(room) || room->query_keep_loaded() || room->query_reset_missing())
+      return 0;
+   foreach (object ob in deep_inventory(room))
+   {
+      if (ob->is_living() && (environment(ob) != room || !room->query_reset_object(ob)))
+         return 0;
+      if (ob->query_reset_missing())
+         return 0;
+   }
+   return 1;
+}
+
+private
+mixed *take_snapshot(object room)
+{
+   string *items = ({});
+   mapping doors = ([]);
+   string *states = room->get_room_state_info() || ({});
+
+   foreach (object ob in all_inventory(room))
+   {
+      if (ob->is_exit())
+      {
+         if (function_exists("query_closed", ob))
+            doors[ob->query_direction()] = ({ob->query_closed(), ob->query_locked(), ob->query_key_type()});
+      }
+      else if (!ob->is_living() && !room->query_reset_object(ob) && !ob->do_not_restore())
+         items += ({ob->save_to_string(1)});
+   }
+   items -= ({0});
+   if (!sizeof(items) && !sizeof(doors) && !sizeof(states))
+      return 0;
+   return ({items, doors, states});
+}
+
+private
+void restore_snapshot(object room, string snapshot)
+{
+   mixed *data = restore_variable(snapshot);
+   mixed *state;
+   object ob;
+
+   foreach (string item in data[0])
+   {
+      mapping value = restore_variable(item);
+
+      if (catch (ob = new (value["#base_name#"])) || !ob)
+         continue;
+      catch (ob->load_from_string(value, 1));
+      if (ob->move(room) != MOVE_OK)
+         destruct(ob);
+   }
+
+   /* Doors that copied their sibling on the way in already agree */
+   foreach (ob in all_inventory(room))
+   {
+      if (!ob->is_exit() || !(state = data[1][ob->query_direction()]))
+         continue;
+      if (ob->query_closed() != state[0])
+         ob->set_closed(state[0]);
+      if (ob->is_lockable() && ob->query_locked() != state[1])
+         ob->set_locked(state[1], state[2]);
+   }
+
+   foreach (string s in data[2])
+   {
+      if (s[ < 3..] == "_on")
+         room->set_room_state(s[0.. < 4]);
+      else
+         room->clear_room_state(s[0.. < 5]);
+   }
+}
+
+private
+int evict_room(object room)
+{
+   mixed *snapshot;
+
+   if (!evictable(room))
+      return 0;
+   if (snapshot = take_snapshot(room))
+      snapshots[file_name(room)] = save_variable(snapshot);
+   map_delete(resident, room);
+
+   /* remove() so the objects tidy up after themselves, see REGISTRY_D */
+   foreach (object ob in all_inventory(room))
+      catch (ob->remove());
+   catch (room->remove());
+   if (room)
+      destruct(room);
+   stat_evicted++;
+   return 1;
+}
+
+//: FUNCTION evict
+// Unloads the room, keeping a snapshot. Returns 1 if it was evicted, 0 if
+// it is in use or not a domain room. Rooms may evict themselves, see
+// clean_up() in BASE_ROOM.
+int evict(object room)
+{
+   if (previous_object() != room && !check_privilege(1))
+      error("Insufficient privilege to evict rooms.\n");
+   return evict_room(room);
+}
+
+//: FUNCTION sweep
+// Evicts the idle rooms. Runs every SWEEP_INTERVAL seconds.
+void sweep()
+{
+   int now = time();
+   object *idle = ({});
+   int evicted;
+
+   /* first, so a room that errors doesn't stop the sweeps */
+   call_out("sweep", SWEEP_INTERVAL);
+   resident = filter(resident, ( : objectp($1) :));
+   foreach (object room, int used in resident)
+      if (now - used >= MIN_IDLE)
+         idle += ({room});
+
+   /* Least recently used first */
+   idle = sort_array(idle, ( : $(resident)[$1] - $(resident)[$2] :));
+   foreach (object room in idle)
+   {
+      if (evicted >= EVICT_BATCH)
+         break;
+      if (now - resident[room] < IDLE_LIMIT && sizeof(resident) <= MAX_RESIDENT)
+         break;
+      if (catch (evicted += evict_room(room)))
+         stat_errors++;
+   }
+   stat_sweeps++;
+}
+
+//: FUNCTION query_snapshot
+// Returns the snapshot kept for the room file, or 0. See take_snapshot().
+mixed *query_snapshot(string name)
+{
+   return snapshots[name] ? restore_variable(snapshots[name]) : 0;
+}
+
+//: FUNCTION query_stats
+// Returns the counters shown by stat_me() as a mapping.
+mapping query_stats()
+{
+   int bytes;
+
+   foreach (string name, string snapshot in snapshots)
+      bytes += strlen(snapshot);
+   return (["resident":sizeof(resident), "max_resident":MAX_RESIDENT, "snapshots":sizeof(snapshots),
+            "snapshot_bytes":bytes, "evicted":stat_evicted, "restored":stat_restored,
+            "restore_usecs":stat_restore_usecs, "restore_max":stat_restore_max, "sweeps":stat_sweeps,
+            "errors":stat_errors]);
+}
+
+void create()
+{
+   if (clonep())
+   {
+      destruct(this_object());
+      return;
+   }
+   call_out("sweep", SWEEP_INTERVAL);
+}
+
+string stat_me()
+{
+   mapping stats = query_stats();
+
+   return "ROOM_LIFECYCLE_D:\n-----------------\n" +
+          sprintf("Resident rooms: %d (cap %d), idle limit %d seconds\n", stats["resident"], MAX_RESIDENT,
+                  IDLE_LIMIT) +
+          sprintf("Snapshots: %d (%d bytes)\n", stats["snapshots"], stats["snapshot_bytes"]) +
+          sprintf("Evicted %d, restored %d (average %d us, worst %d us) in %d sweeps\n", stat_evicted,
+                  stat_restored, stat_restored ? stat_restore_usecs / stat_restored : 0, stat_restore_max,
+                  stat_sweeps) +
+          sprintf("Rooms that errored while being evicted: %d\n", stat_errors) +
+          sprintf("Driver memory: %d bytes\n", memory_info()) + "\n";
+}
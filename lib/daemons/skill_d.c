@@ -14,6 +14,23 @@ inherit CLASS_SKILL;
 */
 private
 mapping skills = ([]);
+
+/*
+** The skill table. Each skill gets an id the first time it is seen after
+** a boot, and keeps it even if the skill is removed and added again, so
+** bodies can keep their skills in arrays indexed by id. For each id the
+** table has the name, the id of the parent skill (-1 for the top level
+** skills) and the depth in the tree (0 for the top level skills).
+*/
+private
+nosave mapping skill_ids = ([]);
+private
+nosave string *skill_names = ({});
+private
+nosave int *skill_parents = ({});
+private
+nosave int *skill_depths = ({});
+
 private
 nosave mixed skill_ranks = ({100,  250,  500,  750,  1000, 1250, 1500, 2000, 2500, 3000,
                              3500, 4000, 4500, 5000, 5500, 6000, 6500, 7000, 8000, 10000});
@@ -34,6 +51,30 @@ nosave mixed skill_titles = ({"",   "1",  "2",  "3",  "4",  "5",  "6",  "7",  "8
 
 #define PRIV_REQUIRED "Mudlib:daemons"
 
+private
+int intern_skill(string skill)
+{
+   int id = skill_ids[skill];
+   int parent = -1;
+   int i;
+
+   if (!undefinedp(id))
+      return id;
+
+   /* parents first, so a parent's id is always below its children's */
+   i = strsrch(skill, '/', -1);
+   if (i != -1)
+      parent = intern_skill(skill[0..i - 1]);
+
+   id = sizeof(skill_names);
+   skill_names += ({skill});
+   skill_parents += ({parent});
+   skill_depths += ({parent == -1 ? 0 : skill_depths[parent] + 1});
+   skill_ids[skill] = id;
+
+   return id;
+}
+
 string *register_skill(string skill)
 {
    string *parts;
@@ -58,6 +99,7 @@ string *register_skill(string skill)
          skills[result[i]] = 1;
       }
    }
+   intern_skill(skill);
 
    save_me();
 
@@ -98,7 +140,30 @@ string *query_skills()
 
 int valid_skill(string s)
 {
-   return member_array(s, query_skills()) != -1;
+   return skills[s] ? 1 : 0;
+}
+
+//: FUNCTION query_skill_id
+// int query_skill_id(string skill);
+// Returns the id of the skill in the skill table, or -1 if it isn't a skill.
+int query_skill_id(string skill)
+{
+   if (!skills[skill])
+      return -1;
+   return intern_skill(skill);
+}
+
+//: FUNCTION query_skill_table
+// mixed *query_skill_table();
+// Returns a copy of ({ ids, names, parents, depths }): a mapping of skill
+// name -> id and arrays indexed by id of the names, the parent ids (-1 for
+// the top level skills) and the depths in the tree. Skills seen later are
+// not in the copy, so a name missing from it whose query_skill_id() isn't
+// -1 means it is time to ask again. Ids of removed skills stay in the
+// table; use valid_skill() to check a name.
+mixed *query_skill_table()
+{
+   return copy(({skill_ids, skill_names, skill_parents, skill_depths}));
 }
 
 int pts_for_rank(int rank)
@@ -230,6 +295,8 @@ int monster_percent_for_next_rank(object mob, string skill_name)
 void create()
 {
    ::create(); //Restore values from .o file
+   foreach (string skill in sort_array(keys(skills), 1))
+      intern_skill(skill);
    if (MAX_SKILL_VALUE != 10000)
    {
       float factor = (MAX_SKILL_VALUE * 1.0) / 10000;
@@ -4,58 +4,249 @@
 ** This daemon periodically calls objects on the MUD to allow them to change state. This can
 ** be used to grow crops, make food rot, make critically wounded things die.
 **
+** Pending updates live in a hierarchical timing wheel: a 60 slot second wheel, a 60 slot
+** minute wheel and a 24 slot hour wheel, with anything further out parked in an overflow
+** mapping. Each slot is a mapping of object -> due time, so scheduling and cancelling are
+** a single mapping operation. Entries cascade down a wheel as their minute, hour or day
+** comes around.
+**
+** Stateful objects register themselves with add_to_queue() (M_STATEFUL does this from
+** mudlib_setup()) and may cancel with remove_from_queue().
+**
 ** Tsath 2020-07-10 (Created)
 */
 
-#define MAX_PROCESSED 10
 #define INITIAL_SPREAD 20
 
-int last_time;
+// The most state_update() calls made in one tick; the rest wait for the next one.
+#define MAX_PROCESSED 500
+
+#define LEVEL_SECONDS 0
+#define LEVEL_MINUTES 1
+#define LEVEL_HOURS 2
+#define LEVEL_OVERFLOW 3
+#define LEVEL_READY 4
+
+private
+nosave int current;
+private
+nosave mapping *seconds, *minutes, *hours;
+private
+nosave mapping overflow = ([]);
+private
+nosave mapping ready = ([]);
+private
+nosave mapping location = ([]);
+private
+nosave mapping due_at = ([]);
+
+private
+nosave int stat_ticks, stat_processed, stat_last_tick, stat_max_tick;
+private
+nosave int stat_late_total, stat_late_max;
+
+private
+void schedule(object ob, int due)
+{
+   // Slots for earlier seconds have already fired. Cascades run before the current
+   // second's slot, so an entry due now still makes it.
+   if (due < current)
+      due = current;
+
+   due_at[ob] = due;
+   if (due / 60 == current / 60)
+   {
+      seconds[due % 60][ob] = due;
+      location[ob] = LEVEL_SECONDS;
+   }
+   else if (due / 3600 == current / 3600)
+   {
+      minutes[(due / 60) % 60][ob] = due;
+      location[ob] = LEVEL_MINUTES;
+   }
+   else if (due / 86400 == current / 86400)
+   {
+      hours[(due / 3600) % 24][ob] = due;
+      location[ob] = LEVEL_HOURS;
+   }
+   else
+   {
+      overflow[ob] = due;
+      location[ob] = LEVEL_OVERFLOW;
+   }
+}
+
+//: FUNCTION remove_from_queue
+// Cancel any pending state update for the object.
+void remove_from_queue(object ob)
+{
+   mixed level = location[ob];
+   int due = due_at[ob];
+
+   if (undefinedp(level))
+      return;
 
-mapping queue = ([]);
+   switch (level)
+   {
+   case LEVEL_SECONDS:
+      map_delete(seconds[due % 60], ob);
+      break;
+   case LEVEL_MINUTES:
+      map_delete(minutes[(due / 60) % 60], ob);
+      break;
+   case LEVEL_HOURS:
+      map_delete(hours[(due / 3600) % 24], ob);
+      break;
+   case LEVEL_OVERFLOW:
+      map_delete(overflow, ob);
+      break;
+   case LEVEL_READY:
+      map_delete(ready, ob);
+      break;
+   }
+   map_delete(location, ob);
+   map_delete(due_at, ob);
+}
 
+//: FUNCTION add_to_queue
+// Schedule a state update for the object query_call_interval() minutes from now, plus
+// add_to_time seconds. An object already in the queue is moved to the new time.
 varargs void add_to_queue(object ob, int add_to_time)
 {
-   int update_time;
    if (ob && ob->query_call_interval())
    {
-      // If the object is already in here, don't add it.
-      /*        if (member_array(ob, flatten_array(values(queue))) != -1)
-                  return;
-      */
-      update_time = (ob->query_call_interval() * 60 + time()) + add_to_time;
+      remove_from_queue(ob);
+      schedule(ob, (ob->query_call_interval() * 60 + time()) + add_to_time);
+   }
+}
+
+private
+void cascade(mapping slot)
+{
+   foreach (object ob, int due in slot)
+      if (ob)
+         schedule(ob, due);
+}
+
+private
+void advance()
+{
+   mapping due_now;
+
+   current++;
+   if (current % 86400 == 0)
+   {
+      mapping later = overflow;
 
-      if (!queue[update_time])
-         queue[update_time] = ({});
+      overflow = ([]);
+      cascade(later);
+   }
+   if (current % 3600 == 0)
+   {
+      due_now = hours[(current / 3600) % 24];
+      hours[(current / 3600) % 24] = ([]);
+      cascade(due_now);
+      location = filter(location, ( : objectp($1) :));
+      due_at = filter(due_at, ( : objectp($1) :));
+   }
+   if (current % 60 == 0)
+   {
+      due_now = minutes[(current / 60) % 60];
+      minutes[(current / 60) % 60] = ([]);
+      cascade(due_now);
+   }
 
-      queue[update_time] += ({ob});
+   due_now = seconds[current % 60];
+   seconds[current % 60] = ([]);
+   foreach (object ob, int due in due_now)
+   {
+      if (!ob)
+         continue;
+      ready[ob] = due;
+      location[ob] = LEVEL_READY;
    }
 }
 
 void process_queue()
 {
    int processed;
-   int t = time();
-   foreach (int update_time, object * targets in queue)
+   int now = time();
+   object *done = ({});
+
+   while (current < now)
+      advance();
+
+   foreach (object target, int due in ready)
    {
-      foreach (object target in targets)
-      {
-         if (target && update_time < time() && target->state_update())
-         {
-            add_to_queue(target);
-         }
-      }
-      if (update_time < time())
-         map_delete(queue, update_time);
-      processed++;
       if (processed == MAX_PROCESSED)
-         return;
+         break;
+      done += ({target});
+      if (!target)
+         continue;
+      processed++;
+      stat_late_total += now - due;
+      if (now - due > stat_late_max)
+         stat_late_max = now - due;
    }
+
+   foreach (object target in done)
+   {
+      int again;
+
+      map_delete(ready, target);
+      if (!target)
+         continue;
+      map_delete(location, target);
+      map_delete(due_at, target);
+      if (catch (again = target->state_update()))
+         continue;
+      if (again)
+         add_to_queue(target);
+   }
+
+   stat_ticks++;
+   stat_processed += processed;
+   stat_last_tick = processed;
+   if (processed > stat_max_tick)
+      stat_max_tick = processed;
+}
+
+//: FUNCTION query_pending
+// Number of objects waiting for a state update, including ones already due.
+int query_pending()
+{
+   return sizeof(location);
 }
 
+//: FUNCTION query_stats
+// Returns a mapping of queue statistics: pending and backlog sizes, the number of
+// updates done in the last and busiest ticks, and lateness in seconds.
+mapping query_stats()
+{
+   return ([
+       "pending":sizeof(location),
+       "backlog":sizeof(ready),
+       "ticks":stat_ticks,
+       "processed":stat_processed,
+       "last_tick":stat_last_tick,
+       "max_tick":stat_max_tick,
+       "avg_late":stat_processed ? to_float(stat_late_total) / stat_processed : 0.0,
+       "max_late":stat_late_max,
+   ]);
+}
+
+//: FUNCTION queue
+// Returns the pending updates as a mapping of due time -> objects. Meant for debugging;
+// it walks every wheel slot.
 mapping queue()
 {
-   return queue;
+   mapping q = ([]);
+
+   foreach (mapping slot in seconds + minutes + hours + ({overflow, ready}))
+      foreach (object ob, int due in slot)
+         if (ob)
+            q[due] = (q[due] || ({})) + ({ob});
+   return q;
 }
 
 void heart_beat()
@@ -63,11 +254,12 @@ void heart_beat()
    process_queue();
 }
 
+//: FUNCTION capture_all_statefuls
+// Queues every stateful clone REGISTRY_D knows of. The wheel isn't saved, so create() calls
+// this to pick up the objects that registered with a previous copy of the daemon.
 void capture_all_statefuls()
 {
-   object *statefuls = filter_array(objects(), ( : clonep($1) && $1->is_stateful() :));
-   queue = ([]);
-   foreach (object ob in statefuls)
+   foreach (object ob in REGISTRY_D->query_type("stateful"))
       add_to_queue(ob, random(INITIAL_SPREAD));
 }
 
@@ -78,13 +270,20 @@ void create()
       destruct(this_object());
       return;
    }
+   current = time();
+   seconds = map(allocate(60), ( : ([]) :));
+   minutes = map(allocate(60), ( : ([]) :));
+   hours = map(allocate(24), ( : ([]) :));
    capture_all_statefuls();
    set_heart_beat(1);
 }
 
 string stat_me()
 {
-   return "STAT_D:\n-------\n" + "Queue Length: " + sizeof(keys(queue)) +
-          "\n"
-          "\n";
+   mapping s = query_stats();
+
+   return "STATE_D:\n--------\n" + sprintf("Pending: %d (%d due, waiting for budget)\n", s["pending"], s["backlog"]) +
+          sprintf("Updates: %d in %d ticks, last tick %d, busiest tick %d (cap %d)\n", s["processed"], s["ticks"],
+                  s["last_tick"], s["max_tick"], MAX_PROCESSED) +
+          sprintf("Lateness: avg %.2fs, max %ds\n", s["avg_late"], s["max_late"]) + "\n";
 }
\ No newline at end of file
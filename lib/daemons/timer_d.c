@@ -5,11 +5,17 @@
 **
 ** Timer facilities.
 **
+** Each timer gets an integer handle. Pending timers live in a min-heap
+** (M_HEAP) keyed by the time they next fire, and the daemon keeps exactly
+** one call_out outstanding, for the earliest of them.
+**
 ** 03-Feb-95. Deathblade. Created.
 */
 
 #include <daemons.h>
 
+inherit M_HEAP;
+
 class timer_info
 {
    int delay;           /* delay between start and end */
@@ -17,34 +23,82 @@ class timer_info
    int repeating;       /* is it a repeating timer? */
    string channel_name; /* channel to announce over */
    int notify_period;   /* how often to give timer notifications */
+   object owner;        /* who the timer belongs to */
+   int due;             /* when the timer next fires */
 }
 
 /*
-** This maps timer owners to a timer_info structure.
+** This maps timer handles to a timer_info structure.
 */
 nosave private mapping timers;
 
+/*
+** Owner -> handle of the timer started with add_timer(). The timer command
+** allows one of these per person.
+*/
+nosave private mapping owner_timers;
+
+nosave private int next_handle;
+nosave private int timer_tag;
+nosave private int timer_due;
+
+nosave private int stat_ticks, stat_fired, stat_last_tick, stat_max_tick;
+nosave private int stat_drift_total, stat_drift_max;
+
 void create()
 {
    timers = ([]);
+   owner_timers = ([]);
+}
+
+private
+void rearm()
+{
+   int due = heap_peek_key();
+
+   if (timer_tag && (!heap_size() || due != timer_due))
+   {
+      remove_call_out(timer_tag);
+      timer_tag = 0;
+   }
+   if (!heap_size() || timer_tag)
+      return;
+   timer_due = due;
+   timer_tag = call_out("process_timers", due > time() ? due - time() : 0);
+}
+
+private
+void drop_timer(int handle)
+{
+   class timer_info data = timers[handle];
+
+   if (data && owner_timers[data.owner] == handle)
+      map_delete(owner_timers, data.owner);
+   map_delete(timers, handle);
+   heap_remove(handle);
+}
+
+private
+void announce(class timer_info data, string notice)
+{
+   if (data.channel_name)
+      CHANNEL_D->deliver_notice(data.channel_name, notice);
+   else if (data.owner)
+      tell(data.owner, notice + ".\n");
 }
 
-nomask void process_timer(object owner)
+private
+void process_timer(int handle)
 {
-   class timer_info data;
+   class timer_info data = timers[handle];
    string notice;
    int t;
 
-   data = timers[owner];
-
    if (data.time_left == 0)
       notice = "The timer has expired";
    else
       notice = sprintf("%d:%02d left on the timer", data.time_left / 60, data.time_left % 60);
-   if (data.channel_name)
-      CHANNEL_D->deliver_notice(data.channel_name, notice);
-   else
-      tell(owner, notice + ".\n");
+   announce(data, notice);
 
    if (data.time_left == 0 && data.repeating)
    {
@@ -54,11 +108,7 @@ nomask void process_timer(object owner)
          t = data.notify_period;
       else
          t = data.delay;
-      notice = sprintf("Timer rescheduled for %d:%02d", data.delay / 60, data.delay % 60);
-      if (data.channel_name)
-         CHANNEL_D->deliver_notice(data.channel_name, notice);
-      else
-         tell(owner, notice + ".\n");
+      announce(data, sprintf("Timer rescheduled for %d:%02d", data.delay / 60, data.delay % 60));
    }
    else if (data.time_left > 0)
    {
@@ -71,26 +121,67 @@ nomask void process_timer(object owner)
    if (t)
    {
       data.time_left -= t;
-      call_out("process_timer", t, owner);
+      // Anchor to the intended time rather than to when the call_out ran,
+      // so lag does not accumulate over a repeating timer.
+      data.due += t;
+      heap_insert(handle, data.due);
    }
+   else
+      drop_timer(handle);
 }
 
-varargs nomask string add_timer(int delay,      /* timer delay */
-                                int repeating,  /* repeating timer? */
-                                string channel, /* channel for notifies */
-                                int notify,     /* period for notifies */
-                                object owner    /* if not this_user() */
-)
+nomask void process_timers()
+{
+   int now = time();
+   int fired;
+
+   timer_tag = 0;
+   while (heap_size() && heap_peek_key() <= now)
+   {
+      int handle = heap_pop();
+      class timer_info data = timers[handle];
+
+      if (!data || (!data.owner && !data.channel_name))
+      {
+         drop_timer(handle);
+         continue;
+      }
+      fired++;
+      stat_drift_total += now - data.due;
+      if (now - data.due > stat_drift_max)
+         stat_drift_max = now - data.due;
+      if (catch (process_timer(handle)))
+         drop_timer(handle);
+   }
+
+   stat_ticks++;
+   stat_fired += fired;
+   stat_last_tick = fired;
+   if (fired > stat_max_tick)
+      stat_max_tick = fired;
+   rearm();
+}
+
+private
+int may_change(class timer_info data)
+{
+   return data.owner == this_user() || data.owner == previous_object() || check_privilege(1);
+}
+
+//: FUNCTION start_timer
+// Starts a timer of <delay> seconds and returns its handle, or 0 on bad
+// parameters. See add_timer() for the meaning of the other arguments.
+varargs nomask int start_timer(int delay, int repeating, string channel, int notify, object owner)
 {
    class timer_info info;
    int t;
 
-   if (!delay || notify > delay)
-      return "Bad parameters.\n";
+   if (delay <= 0 || notify > delay)
+      return 0;
    if (!owner)
       owner = this_user();
-   if (!owner)
-      return "No owner.\n";
+   if (!owner && !channel)
+      return 0;
 
    /*
    ** Compute the first delay time
@@ -106,18 +197,79 @@ varargs nomask string add_timer(int delay,      /* timer delay */
    info.repeating = repeating;
    info.channel_name = channel;
    info.notify_period = notify;
-   timers[owner] = info;
+   info.owner = owner;
+   info.due = time() + t;
+   timers[++next_handle] = info;
 
-   remove_call_out("process_timer");
-   call_out("process_timer", t, owner);
+   heap_insert(next_handle, info.due);
+   rearm();
 
    if (channel)
-   {
-      string notice;
+      CHANNEL_D->deliver_notice(channel, sprintf("timer set to %d:%02d", delay / 60, delay % 60));
+   return next_handle;
+}
+
+//: FUNCTION cancel_timer
+// Stops a timer. Returns 1 if it was stopped.
+nomask int cancel_timer(int handle)
+{
+   class timer_info data = timers[handle];
+
+   if (!data || !may_change(data))
+      return 0;
+   drop_timer(handle);
+   rearm();
+   return 1;
+}
+
+//: FUNCTION reschedule_timer
+// Restarts a timer so that it runs for <delay> seconds from now, keeping
+// its other settings. Returns 1 on success.
+nomask int reschedule_timer(int handle, int delay)
+{
+   class timer_info data = timers[handle];
+   int t;
+
+   if (!data || delay <= 0 || !may_change(data))
+      return 0;
+   if (data.notify_period && data.notify_period < delay)
+      t = data.notify_period;
+   else
+      t = delay;
+   data.delay = delay;
+   data.time_left = delay - t;
+   data.due = time() + t;
+   heap_insert(handle, data.due);
+   rearm();
+   return 1;
+}
+
+varargs nomask string add_timer(int delay,      /* timer delay */
+                                int repeating,  /* repeating timer? */
+                                string channel, /* channel for notifies */
+                                int notify,     /* period for notifies */
+                                object owner    /* if not this_user() */
+)
+{
+   int handle;
+
+   if (!owner)
+      owner = this_user();
+   if (!owner)
+      return "No owner.\n";
 
-      notice = sprintf("timer set to %d:%02d", delay / 60, delay % 60);
-      CHANNEL_D->deliver_notice(channel, notice);
+   /* One timer per person; a new one (or a delay of 0) replaces it */
+   if (owner_timers[owner])
+   {
+      drop_timer(owner_timers[owner]);
+      rearm();
+      if (!delay)
+         return "Timer stopped.\n";
    }
+
+   if (!(handle = start_timer(delay, repeating, channel, notify, owner)))
+      return "Bad parameters.\n";
+   owner_timers[owner] = handle;
    return "Done.\n";
 }
 
@@ -125,3 +277,31 @@ mapping query_timers()
 {
    return timers;
 }
+
+//: FUNCTION query_stats
+// Returns timer statistics: pending timers, call_outs processed, timers
+// fired in the last and busiest ticks, and drift (seconds late) in total
+// and at worst.
+mapping query_stats()
+{
+   return ([
+       "pending":heap_size(),
+       "ticks":stat_ticks,
+       "fired":stat_fired,
+       "last_tick":stat_last_tick,
+       "max_tick":stat_max_tick,
+       "avg_drift":stat_fired ? to_float(stat_drift_total) / stat_fired : 0.0,
+       "max_drift":stat_drift_max,
+   ]);
+}
+
+string stat_me()
+{
+   mapping s = query_stats();
+
+   return "TIMER_D:\n--------\n" + sprintf("Pending: %d, next in %s\n", s["pending"],
+                                           s["pending"] ? (heap_peek_key() - time()) + "s" : "-") +
+          sprintf("Fired: %d in %d ticks, last tick %d, busiest tick %d\n", s["fired"], s["ticks"], s["last_tick"],
+                  s["max_tick"]) +
+          sprintf("Drift: avg %.2fs, max %ds\n", s["avg_drift"], s["max_drift"]) + "\n";
+}
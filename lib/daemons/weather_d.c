@@ -17,6 +17,7 @@ nosave private string *type_nouns = ({"sun", "rain", "fog", "snow"});
 ** Globals.
 */
 nosave private int weather_state;
+nosave private int generation;
 
 string show_weather_change(int last_state)
 {
@@ -67,6 +68,7 @@ void change_weather()
    weather_state = random(sizeof(types));
    if (weather_state != last_state)
    {
+      generation++;
       buf_me_once = show_weather_change(last_state);
       foreach (body in bodies() - ({0}))
       {
@@ -87,6 +89,14 @@ string query_current_weather()
    return ("There is " + type_nouns[weather_state] + " falling down around you.");
 }
 
+//: FUNCTION query_generation
+// Goes up by one every time the weather changes, so rooms that show the
+// weather can tell when their cached descriptions are out of date.
+int query_generation()
+{
+   return generation;
+}
+
 void create()
 {
    change_weather();
@@ -10,6 +10,19 @@
 
 inherit M_DAEMON_DATA;
 
+// One SGR (colour and style) escape sequence, as substitute_colour() makes them.
+#define SGR_SEQUENCE "\e\\[[0-9;]*m"
+
+// The terminal state minimise_sgr() follows, see apply_sgr().
+#define SGR_FG 0
+#define SGR_BG 1
+#define SGR_BOLD 2
+#define SGR_ITALIC 3
+#define SGR_UNDERLINE 4
+#define SGR_FLASH 5
+#define SGR_REVERSE 6
+#define SGR_DEFAULT ({"", "", 0, 0, 0, 0, 0})
+
 private
 nosave string *fg_codes = ({});
 private
@@ -26,6 +39,8 @@ private
 nosave mapping ansi;
 private
 nosave mapping client_compat = ([]);
+private
+nosave int sgr_messages, sgr_bytes_in, sgr_bytes_out;
 
 private
 void load_all_colours();
@@ -396,6 +411,222 @@ string xterm256_wrap(string str, int wrap_at, int indent_at)
    return implode(map(explode(implode(parts, " "), "\n"), ( : rtrim:)), "\n");
 }
 
+/*
+** Applies the parameters of one SGR sequence to state. Returns 0 if one
+** of them is something we don't follow, leaving the state unknown, 2 if
+** they reset the terminal and 1 otherwise.
+*/
+private
+int apply_sgr(mixed *state, string params)
+{
+   string *codes = explode(params, ";");
+   int ret = 1;
+   int i;
+
+   if (!sizeof(codes))
+      codes = ({"0"});
+   while (i < sizeof(codes))
+   {
+      int code = to_int(codes[i]);
+      int n;
+
+      switch (code)
+      {
+      case 0:
+         state[SGR_FG] = state[SGR_BG] = "";
+         state[SGR_BOLD] = state[SGR_ITALIC] = state[SGR_UNDERLINE] = state[SGR_FLASH] = state[SGR_REVERSE] = 0;
+         ret = 2;
+         break;
+      case 1:
+      case 22:
+         state[SGR_BOLD] = code == 1;
+         break;
+      case 3:
+      case 23:
+         state[SGR_ITALIC] = code == 3;
+         break;
+      case 4:
+      case 24:
+         state[SGR_UNDERLINE] = code == 4;
+         break;
+      case 5:
+      case 25:
+         state[SGR_FLASH] = code == 5;
+         break;
+      case 7:
+      case 27:
+         state[SGR_REVERSE] = code == 7;
+         break;
+      case 30..37:
+      case 90..97:
+         state[SGR_FG] = "" + code;
+         break;
+      case 39:
+         state[SGR_FG] = "";
+         break;
+      case 40..47:
+      case 100..107:
+         state[SGR_BG] = "" + code;
+         break;
+      case 49:
+         state[SGR_BG] = "";
+         break;
+      case 38:
+      case 48:
+         /* 38;5;n or 38;2;r;g;b, and the same for the background */
+         if (i + 1 < sizeof(codes))
+            n = codes[i + 1] == "5" ? 3 : (codes[i + 1] == "2" ? 5 : 0);
+         if (!n || i + n > sizeof(codes))
+            return 0;
+         state[code == 38 ? SGR_FG : SGR_BG] = implode(codes[i..i + n - 1], ";");
+         i += n;
+         continue;
+      default:
+         return 0;
+      }
+      i++;
+   }
+
+   return ret;
+}
+
+/*
+** The SGR parameters that take the terminal from one state to the other.
+** Only xterm mode trusts the terminal with the codes that turn styles
+** and colours off; otherwise that takes a reset, after which whatever is
+** still wanted is set again.
+*/
+private
+string *sgr_changes(mixed *from, mixed *to, int xterm)
+{
+   string *codes = ({});
+
+   if (!xterm && ((from[SGR_BOLD] && !to[SGR_BOLD]) || (from[SGR_ITALIC] && !to[SGR_ITALIC]) ||
+                  (from[SGR_UNDERLINE] && !to[SGR_UNDERLINE]) || (from[SGR_FLASH] && !to[SGR_FLASH]) ||
+                  (from[SGR_REVERSE] && !to[SGR_REVERSE]) || (from[SGR_FG] != "" && to[SGR_FG] == "") ||
+                  (from[SGR_BG] != "" && to[SGR_BG] == "")))
+   {
+      codes = ({"0"});
+      from = SGR_DEFAULT;
+   }
+
+   if (to[SGR_FG] != from[SGR_FG])
+      codes += ({to[SGR_FG] == "" ? "39" : to[SGR_FG]});
+   if (to[SGR_BG] != from[SGR_BG])
+      codes += ({to[SGR_BG] == "" ? "49" : to[SGR_BG]});
+   if (to[SGR_BOLD] != from[SGR_BOLD])
+      codes += ({to[SGR_BOLD] ? "1" : "22"});
+   if (to[SGR_ITALIC] != from[SGR_ITALIC])
+      codes += ({to[SGR_ITALIC] ? "3" : "23"});
+   if (to[SGR_UNDERLINE] != from[SGR_UNDERLINE])
+      codes += ({to[SGR_UNDERLINE] ? "4" : "24"});
+   if (to[SGR_FLASH] != from[SGR_FLASH])
+      codes += ({to[SGR_FLASH] ? "5" : "25"});
+   if (to[SGR_REVERSE] != from[SGR_REVERSE])
+      codes += ({to[SGR_REVERSE] ? "7" : "27"});
+
+   /* back to the defaults, which a reset does in the fewest bytes */
+   if (sizeof(codes) && to[SGR_FG] == "" && to[SGR_BG] == "" && !to[SGR_BOLD] && !to[SGR_ITALIC] &&
+       !to[SGR_UNDERLINE] && !to[SGR_FLASH] && !to[SGR_REVERSE])
+      return ({"0"});
+
+   return codes;
+}
+
+//: FUNCTION minimise_sgr
+// Takes text that has been through substitute_colour() and rewrites its
+// colour and style escape sequences so the terminal ends up the same for
+// fewer bytes. Changes that change nothing are dropped, changes next to
+// each other go out as one sequence, and reset is only sent when something
+// can't be turned off otherwise. What the terminal shows when the text
+// starts isn't known, so nothing is dropped before the first reset. mode
+// is the terminal mode of the user, see substitute_colour().
+public
+string minimise_sgr(string text, string mode)
+{
+   mixed *assoc;
+   string *parts, *result = ({});
+   string *pending = ({});
+   int *matched;
+   mixed *wanted = copy(SGR_DEFAULT);
+   mixed *shown;
+   int trusted;
+   int xterm = mode == "xterm";
+   int size;
+
+   if (nullp(text) || mode == "plain" || strsrch(text, 27) == -1)
+      return text;
+
+   size = strlen(text);
+   assoc = pcre_assoc(text, ({SGR_SEQUENCE}), ({1}));
+   parts = assoc[0];
+   matched = assoc[1];
+
+   /* one pass more than there are parts, to send what's pending at the end */
+   for (int i = 0; i <= sizeof(parts); i++)
+   {
+      if (i < sizeof(parts) && matched[i])
+      {
+         string params = parts[i][2.. < 2];
+
+         switch (apply_sgr(wanted, params))
+         {
+         case 0:
+            trusted = 0;
+            break;
+         case 2:
+            trusted = 1;
+            break;
+         }
+         pending += ({params == "" ? "0" : params});
+         continue;
+      }
+      if (i < sizeof(parts) && parts[i] == "")
+         continue;
+
+      if (sizeof(pending))
+      {
+         if (shown && trusted)
+         {
+            string *codes = sgr_changes(shown, wanted, xterm);
+
+            if (sizeof(codes))
+               result += ({"\e[" + implode(codes, ";") + "m"});
+         }
+         else
+            result += ({"\e[" + implode(pending, ";") + "m"});
+         shown = trusted ? copy(wanted) : 0;
+         pending = ({});
+      }
+      if (i < sizeof(parts))
+         result += ({parts[i]});
+   }
+
+   text = implode(result, "");
+   sgr_messages++;
+   sgr_bytes_in += size;
+   sgr_bytes_out += strlen(text);
+
+   return text;
+}
+
+//: FUNCTION query_sgr_stats
+// Returns what minimise_sgr() has done since the daemon was loaded: the
+// number of texts with escape sequences in them, and their bytes before
+// and after.
+mapping query_sgr_stats()
+{
+   return (["messages":sgr_messages, "bytes_in":sgr_bytes_in, "bytes_out":sgr_bytes_out]);
+}
+
+string stat_me()
+{
+   return "XTERM256_D:\n-----------\n" +
+          sprintf("SGR minimiser: %d texts, %d bytes in, %d bytes out (%d saved)\n", sgr_messages, sgr_bytes_in,
+                  sgr_bytes_out, sgr_bytes_in - sgr_bytes_out) +
+          "\n";
+}
+
 int ansip(string text)
 {
    return pcre_match(text, PINKFISH_COLOURS);
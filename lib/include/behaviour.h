@@ -21,6 +21,14 @@
 //The pause when handling a leaf node. Recommended between 2-5.
 #define LEAF_NODE_PAUSE 2
 
+//Seconds without a player in the room before a tree goes dormant and stops
+//evaluating. NPCs can change it with set_dormancy_delay(), 0 never sleeps.
+#define DORMANCY_DELAY 120
+
+//At most this many coarse catch-up steps are taken when a tree wakes up
+//after set_dormancy_catch_up(1). See catch_up() in clusters/base.c.
+#define MAX_CATCH_UP_STEPS 3
+
 /* Do not touch anything below this point*/
 
 #define CLUSTERS "/std/behaviour/clusters/"
@@ -29,6 +37,12 @@
 #ifndef __BEHAVIOR_H__
 #define __BEHAVIOR_H__
 
+// Lines kept by the trace recorder, see set_trace() in clusters/base.c
+#define TRACE_SIZE 64
+
+// Only builds the trace line when tracing is on.
+#define BT_TRACE(x) if (tracing) record_trace(x)
+
 #define EVAL_NONE -1
 #define EVAL_SUCCESS 1
 #define EVAL_RUNNING 2
@@ -9,4 +9,15 @@
 #define CC_HIDE_SIMPLE_STUNS 4
 #define CC_HIDE_DODGES 5
 
+/* How much of other people's fights an observer sees, see set_combat_digest() */
+#define CD_FULL 0
+#define CD_PAIRS 1
+#define CD_ROOM 2
+
+/* The entry kept for each attacker and target in a round digest */
+#define CD_HITS 0
+#define CD_MISSES 1
+#define CD_WORST 2
+#define CD_FEATS 3
+
 #endif
\ No newline at end of file
@@ -65,6 +65,8 @@
 **                                                                         **
 ** PULSE_HEART_BEAT	    Does heart_beat() drive your combat?              **
 ** PULSE_NON_HEART_BEAT Or not?                                            **
+** PULSE_ROUND          One round per room from COMBAT_D, combatants in    **
+**                      initiative order, output batched per observer      **
 **                                                                         **
 *****************************************************************************
 **
@@ -120,6 +122,7 @@
 #define ARMOR_LIMBS           3
 #define PULSE_HEART_BEAT      1
 #define PULSE_NON_HEART_BEAT  2
+#define PULSE_ROUND           3
 #define BLOW_SIMPLE           1
 #define BLOW_TYPES            2
 #define FORMULA_SIMPLE        1
@@ -136,7 +139,7 @@
 #define HEALTH_STYLE      HEALTH_LIMBS
 #define WIELD_STYLE       WIELD_LIMBS
 #define ARMOR_STYLE       ARMOR_LIMBS
-#define PULSE_STYLE       PULSE_HEART_BEAT
+#define PULSE_STYLE       PULSE_ROUND
 #define BLOW_STYLE        BLOW_TYPES
 #define FORMULA_STYLE     FORMULA_SKILLS
 #define ADVANCEMENT_STYLE ADVANCEMENT_SIMPLE
@@ -205,6 +208,10 @@
 #else
 #if PULSE_STYLE == PULSE_HEART_BEAT
 #define PULSE_MODULE heart_beat
+#else
+#if PULSE_STYLE == PULSE_ROUND
+#define PULSE_MODULE round
+#endif
 #endif
 #endif
 
@@ -88,6 +88,11 @@
 #define USE_MASS
 #endif
 
+/* Containers keep the mass of their contents as a running total.  Define
+ * this to recount the contents every time the total is used and raise an
+ * error if the two differ.  Slow; only for tracking down bugs. */
+#undef VERIFY_CONTAINER_MASS
+
 /* If you want weight to be calculated in metric (kilo) rather than imperial (lbs)
    Only works use USE_MASS is defined.
 */
@@ -233,6 +238,11 @@
  ** 									                                                  **
  *************************************************************************/
 
+/* Define this to have call_hooks() count the calls and eval cost of each
+ * hook tag across the mud, see HOOK_STATS_D.  It costs a little on every
+ * call that runs hooks, so leave it off unless you are hunting slow hooks. */
+#undef HOOK_STATS
+
 /* Max file size for editing etc (eg "ulimit -H -d 1200") */
 #define MAX_FILE_SIZE 1000000
 
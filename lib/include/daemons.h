@@ -40,9 +40,17 @@
 #define TIMER_D       "/daemons/timer_d"
 #define VERB_D        "/daemons/verb_d"
 #define WEATHER_D     "/daemons/weather_d"
+#define EFFECTS_D     "/daemons/effects_d"
 #define EMOJI_D       "/daemons/emoji_d"
 #define CRAFTING_D    "/daemons/crafting_d"
+#define COMBAT_D      "/daemons/combat_d"
 #define STATE_D       "/daemons/state_d"
+#define BEHAVIOUR_D   "/daemons/behaviour_d"
+#define ROOM_GRAPH_D  "/daemons/room_graph_d"
+#define REGISTRY_D    "/daemons/registry_d"
+#define ROOM_LIFECYCLE_D "/daemons/room_lifecycle_d"
+#define RESET_D       "/daemons/reset_d"
+#define HOOK_STATS_D  "/daemons/hook_stats_d"
 
 #define DOMAIN_D      "/daemons/domain_d"
 #define LOOT_D        "/daemons/loot_d"
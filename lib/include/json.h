@@ -0,0 +1,16 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+#ifndef __JSON_H__
+#define __JSON_H__
+
+/*
+** Return values of json_decode_step()
+*/
+#define JSON_DONE       1   /* the whole document has been decoded */
+#define JSON_PENDING    0   /* the step budget ran out; call again */
+#define JSON_NEED_INPUT -1  /* waiting for json_decode_feed() */
+
+/* Tokens decoded per call_out by json_decode_async() unless told otherwise */
+#define JSON_ASYNC_BUDGET 2000
+
+#endif /* __JSON_H__ */
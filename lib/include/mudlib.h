@@ -229,6 +229,7 @@
 #define M_CONVERSATION    "/std/modules/m_conversation"
 #define M_WIDGETS         "/std/modules/m_widgets"
 #define M_STATEFUL        "/std/modules/m_stateful"
+#define M_HEAP            "/std/modules/m_heap"
 
 /* for area objects */
 #define M_ACCOUNTANT      "/std/modules/m_accountant"
@@ -0,0 +1,110 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** behaviour.c -- compare the compiled behaviour tree evaluator against the
+** name-keyed one kept in /obj/bench/legacy/behaviour_tree.
+**
+** 1,000 trees of each kind are cloned, all with the same small tree of
+** selectors, sequences and decorators, and every tree is stepped the given
+** number of times. A step runs the tree until a leaf asks for a pause,
+** which is what one call_out of a live NPC does. Clones of this object are
+** the trees for the current evaluator.
+*/
+
+#include <behaviour.h>
+
+inherit BEHAVIOUR_TREE;
+
+#define LEGACY "/obj/bench/legacy/behaviour_tree"
+#define TREES 1000
+
+int see_enemy()
+{
+   return EVAL_FAILURE;
+}
+
+int see_friend()
+{
+   return EVAL_SUCCESS;
+}
+
+int bored()
+{
+   return EVAL_FAILURE;
+}
+
+int tidy()
+{
+   return EVAL_SUCCESS;
+}
+
+int rest()
+{
+   return EVAL_FAILURE;
+}
+
+void create()
+{
+   if (!clonep())
+      return;
+   node_list = ([]);
+   parents = ([]);
+   create_node(NODE_ROOT, "root", "root_sequence");
+   create_node(NODE_SEQUENCE, "root_sequence", ({"look", "mood", "act"}));
+   create_node(NODE_SELECTOR, "look", ({"see_enemy", "see_friend"}));
+   create_node(NODE_LEAF, "see_enemy");
+   create_node(NODE_LEAF, "see_friend");
+   create_node(NODE_INVERTER, "mood", "bored");
+   create_node(NODE_LEAF, "bored");
+   create_node(NODE_SUCCEEDER, "act", "chores");
+   create_node(NODE_SEQUENCE, "chores", ({"tidy", "rest"}));
+   create_node(NODE_LEAF, "tidy");
+   create_node(NODE_LEAF, "rest");
+   set_dormancy_delay(0);
+   compile_tree();
+}
+
+private
+void run_trees(object *trees, int steps)
+{
+   foreach (object tree in trees)
+      for (int i = 0; i < steps; i++)
+         tree->step_tree();
+}
+
+private
+string rate(int steps, int usecs)
+{
+   return usecs ? sprintf("%d", to_int(steps * 1000000.0 / usecs)) : "-";
+}
+
+string bench(int iterations)
+{
+   object *old_trees = ({}), *new_trees = ({});
+   int t_old, t_new, steps;
+
+   if (iterations <= 0)
+      iterations = 10;
+   if (clonep())
+      return "Run the benchmark from the blueprint.\n";
+
+   for (int i = 0; i < TREES; i++)
+   {
+      old_trees += ({clone_object(LEGACY)});
+      new_trees += ({clone_object(base_name())});
+   }
+
+   t_old = time_expression(run_trees(old_trees, iterations));
+   t_new = time_expression(run_trees(new_trees, iterations));
+   steps = TREES * iterations;
+
+   foreach (object ob in old_trees + new_trees)
+      destruct(ob);
+
+   return sprintf("Behaviour tree benchmark, %d trees, %d steps each\n"
+                  "%-10s %12s %12s\n"
+                  "%-10s %10dus %10dus\n"
+                  "%-10s %12s %12s\n",
+                  TREES, iterations, "", "legacy", "current", "time", t_old, t_new, "steps/sec",
+                  rate(steps, t_old), rate(steps, t_new));
+}
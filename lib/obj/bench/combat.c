@@ -0,0 +1,69 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** combat.c -- time the target's side of a hit.
+**
+** A clone of this object is the target. Each hit picks a limb the way an
+** attack does, runs the event through modify_event() (natural and worn
+** armour) and applies the damage with hurt_us(), which is what every blow
+** that lands costs the one being hit. The target is healed every HEAL_EVERY
+** hits so it doesn't die; the healing is timed separately and left out of
+** the rate.
+*/
+
+#include <combat_modules.h>
+
+inherit ADVERSARY;
+
+#define HEAL_EVERY 100
+
+void setup()
+{
+   set_name("dummy");
+   set_id("dummy", "bench dummy");
+   set_natural_armor(4);
+   update_body_style("humanoid");
+}
+
+private
+void hit(object target, int count)
+{
+   class event_info evt;
+
+   for (int i = 0; i < count; i++)
+   {
+      string limb = target->query_random_limb();
+
+      if (!limb)
+         continue;
+      evt = new (class event_info, target : target, target_extra : limb, data : ({"blow", 2}));
+      evt = target->modify_event(evt);
+      target->hurt_us(event_damage(evt), limb);
+   }
+}
+
+string bench(int iterations)
+{
+   object target;
+   int t_hits, t_heal;
+
+   if (iterations <= 0)
+      iterations = 10000;
+   if (clonep())
+      return "Run the benchmark from the blueprint.\n";
+
+   target = new (base_name());
+   for (int done = 0; done < iterations; done += HEAL_EVERY)
+   {
+      t_hits += time_expression(hit(target, HEAL_EVERY));
+      t_heal += time_expression(target->heal_all());
+   }
+   destruct(target);
+
+   return sprintf("Combat benchmark, %d hits on a %s\n"
+                  "%-10s %10dus\n"
+                  "%-10s %10dus\n"
+                  "%-10s %12s\n",
+                  iterations, "humanoid", "hits", t_hits, "healing", t_heal, "hits/sec",
+                  t_hits ? sprintf("%d", to_int(iterations * 1000000.0 / t_hits)) : "-");
+}
@@ -0,0 +1,54 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** json.c -- compare the json_encode()/json_decode() simul_efuns against
+** the v1.0.5 implementation kept in /obj/bench/legacy/json.
+**
+** The sample document is shaped like an I3 mudlist: one mapping per mud,
+** each holding strings, numbers and a nested services mapping.
+*/
+
+#define LEGACY "/obj/bench/legacy/json"
+
+private
+mapping sample(int muds)
+{
+   mapping list = ([]);
+
+   for (int i = 0; i < muds; i++)
+      list["Mud " + i] = (["state":-1,
+                         "address":"10.0.0." + (i % 250),
+                         "ports":({4000 + i, 4001 + i}),
+                         "mudlib":"Lima \"1.1\"",
+                         "admin":"admin" + i + "@example.org",
+                         "services":(["tell":1, "who":1, "finger":1, "channel":1, "emoteto":1]),
+                         "load":i * 0.25,
+                         "notes":"line one\nline two\ttabbed"]);
+   return list;
+}
+
+string bench(int iterations)
+{
+   mapping doc;
+   string text;
+   int t_new_enc, t_old_enc, t_new_dec, t_old_dec;
+
+   if (iterations <= 0)
+      iterations = 200;
+   doc = sample(iterations);
+   text = json_encode(doc);
+
+   t_old_enc = time_expression(LEGACY->json_encode(doc));
+   t_new_enc = time_expression(json_encode(doc));
+   t_old_dec = time_expression(LEGACY->json_decode(text));
+   t_new_dec = time_expression(json_decode(text));
+
+   return sprintf("JSON benchmark, %d muds, %d bytes\n"
+                  "%-10s %12s %12s\n"
+                  "%-10s %10dus %10dus\n"
+                  "%-10s %10dus %10dus\n"
+                  "Round trip %s.\n",
+                  iterations, strlen(text), "", "legacy", "current", "encode", t_old_enc, t_new_enc, "decode",
+                  t_old_dec, t_new_dec,
+                  strlen(json_encode(json_decode(text))) == strlen(text) ? "ok" : "FAILED");
+}
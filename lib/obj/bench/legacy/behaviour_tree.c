@@ -0,0 +1,281 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** The behaviour tree evaluator as it was before the node table was
+** compiled, kept for /obj/bench/behaviour. Nodes are looked up by name,
+** debug strings are built on every visit, and the call_out at the end of
+** a step is replaced by returning the delay.
+*/
+
+#include <behaviour.h>
+
+inherit NODE_CLASS;
+
+mapping node_list = ([]);
+mapping parents = ([]);
+mapping blackboard = ([]);
+
+private
+object debugee = 0;
+private
+string *queue = ({});
+
+string status(int s)
+{
+   switch (s)
+   {
+   case -1:
+      return "<135>NONE<res>";
+   case 0:
+      return "<135>FAILURE<res>";
+   case 1:
+      return "<135>SUCCESS<res>";
+   case 2:
+      return "<135>RUNNING<res>";
+   }
+}
+
+void backpush(mixed node)
+{
+   if (arrayp(node))
+      queue += node;
+   else
+      queue += ({node});
+}
+
+void frontpush(string node)
+{
+   queue = ({node}) + queue;
+}
+
+string print_queue()
+{
+   return format_list(queue);
+}
+
+void reset_tree()
+{
+   foreach (string name, class node node in node_list)
+   {
+      node.status = EVAL_NONE;
+      node.node_num = 0;
+   }
+   queue = ({});
+}
+
+class node front()
+{
+   return sizeof(queue) ? node_list[queue[0]] : 0;
+}
+
+class node parent(class node node)
+{
+   return node && parents[node.name] ? node_list[parents[node.name]] : 0;
+}
+
+class node pop()
+{
+   class node n = front();
+   queue = sizeof(queue) ? queue[1..] : ({});
+   return n;
+}
+
+string discover_parent(string node)
+{
+   string parent;
+   string *names = keys(node_list);
+   int i = 0;
+   while (!parent && i < sizeof(names))
+   {
+      if (member_array(node, node_list[names[i]].children) != -1)
+         parent = names[i];
+      i++;
+   }
+   return parent;
+}
+
+varargs void create_node(int type, string name, mixed offspring)
+{
+   node_list[name] = new (class node, type
+                          : type, name
+                          : name, children
+                          : arrayp(offspring) ? offspring
+                            : offspring       ? ({offspring})
+                                              : ({}),
+                            delay
+                          : type == NODE_LEAF ? LEAF_NODE_PAUSE : 0);
+   parents[name] = discover_parent(name);
+}
+
+int query_observers()
+{
+   return 1;
+}
+
+int debugging()
+{
+   return objectp(debugee);
+}
+
+void debug(mixed s)
+{
+   if (debugee && debugee->is_body())
+      tell(debugee, sprintf("%s: %O\n", __FILE__, (s)));
+}
+
+// Returns the delay the tree asked for when it stopped.
+varargs int evaluate_node()
+{
+   class node node, parent;
+   node = front();
+   parent = parent(node);
+
+   if (!node)
+   {
+      debug("<161>Queue empty - missing node? Restarting from <069>ROOT<res>.");
+      frontpush("root");
+      return 0;
+   }
+
+   debug("<214>Evaluating node: <043>" + node.name + "<res> <214>Queue: <043>" + print_queue() + "<res>");
+   switch (node.type)
+   {
+   case NODE_ROOT:
+      debug(blackboard);
+      debug("<069>ROOT<res> node.");
+      reset_tree();
+      backpush(node.children[0]);
+      if (query_observers())
+         return evaluate_node();
+      return 0;
+   case NODE_SEQUENCE:
+      debug("<154>SEQUENCE, node: <043>" + node.name + "<res> child: " + node.node_num +
+            " status: " + status(node.status) + "<res>");
+      if (node.status == EVAL_FAILURE || (node.node_num >= sizeof(node.children) && parent))
+      {
+         parent.status = node.status;
+         frontpush(parent.name);
+      }
+      else
+      {
+         debug("<154>SEQUENCE CONTINUE node: <043>" + node.name + " status: " + status(node.status) + "<res>");
+         frontpush(node.children[node.node_num]);
+         node.status = EVAL_RUNNING;
+         node.node_num++;
+      }
+      break;
+   case NODE_LEAF:
+      debug("<154>LEAF <043>" + node.name + "<res>");
+      parent.status = call_other(this_object(), node.name);
+      pop();
+      break;
+   case NODE_SELECTOR:
+      debug("<154>SELECTOR <043>" + node.name + "<154> child: " + node.node_num + " Status: " + status(node.status) +
+            "<res>");
+      if (node.node_num >= sizeof(node.children) && parent)
+      {
+         parent.status = node.status;
+         frontpush(parent.name);
+      }
+      else
+      {
+         if (node.status == EVAL_SUCCESS)
+         {
+            debug("<154>SELECTOR STOPPED node: <043>" + node.name + " status: " + status(node.status) + "<res> ");
+            parent.status = node.status;
+            frontpush(parent.name);
+         }
+         else
+         {
+            debug("<154>SELECTOR CONTINUES node: <043>" + node.name + " status: " + status(node.status) + "<res> ");
+            frontpush(node.children[node.node_num]);
+            node.status = EVAL_RUNNING;
+            node.node_num++;
+         }
+      }
+      break;
+   case NODE_INVERTER:
+      if (node.status != EVAL_RUNNING && node.status != EVAL_NONE)
+      {
+         parent.status = !node.status;
+         frontpush(parent.name);
+      }
+      else
+      {
+         debug("<154>INVERTER: <043>" + node.name + "<res>");
+         frontpush(node.children[0]);
+         node.status = EVAL_RUNNING;
+         node.node_num++;
+      }
+      break;
+   case NODE_SUCCEEDER:
+      if (node.status != EVAL_RUNNING && node.status != EVAL_NONE)
+      {
+         node.status = EVAL_SUCCESS;
+         parent.status = EVAL_SUCCESS;
+         frontpush(parent.name);
+      }
+      else
+      {
+         debug("<154>SUCCEEDER: <043>" + node.name + "<res>");
+         frontpush(node.children[0]);
+         node.status = EVAL_RUNNING;
+      }
+      break;
+   default:
+      debug("<161>Don't know what to do with the <043>" + node.name + "<161> node<res>");
+      break;
+   }
+
+   if (node.delay > 0)
+   {
+      debug("<077>Queue delay: " + node.delay + " seconds.<res>");
+      return node.delay;
+   }
+   return evaluate_node(parent);
+}
+
+int step_tree()
+{
+   return evaluate_node();
+}
+
+int see_enemy()
+{
+   return EVAL_FAILURE;
+}
+
+int see_friend()
+{
+   return EVAL_SUCCESS;
+}
+
+int bored()
+{
+   return EVAL_FAILURE;
+}
+
+int tidy()
+{
+   return EVAL_SUCCESS;
+}
+
+int rest()
+{
+   return EVAL_FAILURE;
+}
+
+void create()
+{
+   create_node(NODE_ROOT, "root", "root_sequence");
+   create_node(NODE_SEQUENCE, "root_sequence", ({"look", "mood", "act"}));
+   create_node(NODE_SELECTOR, "look", ({"see_enemy", "see_friend"}));
+   create_node(NODE_LEAF, "see_enemy");
+   create_node(NODE_LEAF, "see_friend");
+   create_node(NODE_INVERTER, "mood", "bored");
+   create_node(NODE_LEAF, "bored");
+   create_node(NODE_SUCCEEDER, "act", "chores");
+   create_node(NODE_SEQUENCE, "chores", ({"tidy", "rest"}));
+   create_node(NODE_LEAF, "tidy");
+   create_node(NODE_LEAF, "rest");
+}
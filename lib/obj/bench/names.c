@@ -0,0 +1,79 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** names.c -- time cloning objects that set up a lot of names.
+**
+** Clones of this object call a dozen of the name setters from setup(),
+** much like a weapon or a piece of armour does. The names are only worked
+** out once something asks for them, so the report times the cloning and
+** the first short() of every clone separately. A second set of clones uses
+** set_names() to do the same in one call.
+*/
+
+inherit OBJ;
+
+#define ITEMS 10000
+
+void setup(string how)
+{
+   if (how == "bulk")
+   {
+      set_names(({"sword", "blade", "longsword", "weapon"}), ({"long", "sharp", "steel", "old", "notched"}),
+                ({"swords", "blades"}));
+      return;
+   }
+   set_id("sword");
+   add_id("blade");
+   add_id("longsword");
+   add_id_no_plural("weapon");
+   set_adj("long");
+   add_adj("sharp", "steel");
+   add_adj("old");
+   add_adj("notched", "rusty");
+   remove_adj("rusty");
+   add_plural("swords", "blades");
+}
+
+private
+object *clone_items(int count, string how)
+{
+   object *items = allocate(count);
+
+   for (int i = 0; i < count; i++)
+      items[i] = new (base_name(), how);
+   return items;
+}
+
+private
+string rate(int count, int usecs)
+{
+   return usecs ? sprintf("%d", to_int(count * 1000000.0 / usecs)) : "-";
+}
+
+string bench(int iterations)
+{
+   object *one_by_one, *bulk;
+   int t_clone, t_short, t_bulk, t_bulk_short;
+
+   if (iterations <= 0)
+      iterations = ITEMS;
+   if (clonep())
+      return "Run the benchmark from the blueprint.\n";
+
+   t_clone = time_expression(one_by_one = clone_items(iterations, "setters"));
+   t_short = time_expression(one_by_one->short());
+   t_bulk = time_expression(bulk = clone_items(iterations, "bulk"));
+   t_bulk_short = time_expression(bulk->short());
+
+   foreach (object ob in one_by_one + bulk)
+      if (ob)
+         destruct(ob);
+
+   return sprintf("Name setup benchmark, %d clones each\n"
+                  "%-10s %12s %12s %12s\n"
+                  "%-10s %10dus %10dus %12s\n"
+                  "%-10s %10dus %10dus %12s\n",
+                  iterations, "", "clone", "short()", "clones/sec", "setters", t_clone, t_short,
+                  rate(iterations, t_clone + t_short), "set_names", t_bulk, t_bulk_short,
+                  rate(iterations, t_bulk + t_bulk_short));
+}
@@ -0,0 +1,99 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+/*
+** sgr.c -- bytes saved by XTERM256_D's minimise_sgr().
+**
+** Takes the output of 'who' and 'score', a frame in every colour theme
+** and a run of combat lines, turns the colour codes into escape sequences
+** the way a user object does, and reports the bytes that would go on the
+** wire before and after minimise_sgr() in xterm and ansi mode. The time
+** is for minimising each sample `iterations` times.
+*/
+
+inherit M_FRAME;
+
+#define MODES ({"xterm", "ansi"})
+
+private
+string combat_sample()
+{
+   string out = "";
+
+   for (int i = 0; i < 10; i++)
+      out += "The troll is %^COMBAT_CONDITION%^stunned%^RESET%^ by a hit to its head!\n"
+             "[%^RED%^WOUNDED!%^RESET%^] Your left arm has " + (20 - i) + " hp!\n"
+             "%^YELLOW%^You gained " + (i * 10) + " xp.%^RESET%^\n"
+             "The orc %^COMBAT_CONDITION%^cannot use%^RESET%^ its right arm anymore.\n"
+             "<bld><196>Troll<res> <res><208>[<res><040>||||||<res><208>]<res>\n";
+   return out;
+}
+
+private
+string frames_sample()
+{
+   string out = "";
+
+   foreach (string colour in query_frame_colour_themes())
+      out += frame_colour_demo("single", colour, 78) + "\n" + frame_colour_demo("double", colour, 78) + "\n";
+
+   frame_init_user();
+   set_frame_title("Frames");
+   set_frame_content(title("Title") + " " + accent("accent") + " " + warning("warning") + "\n" +
+                     repeat_string(accent("x") + accent("y") + "\n", 10));
+   return out + frame_render();
+}
+
+private
+string substitute(string text, string mode)
+{
+   return implode(map(explode(text, "\n"), ( : XTERM256_D->substitute_colour($1, $(mode)) :)), "\n");
+}
+
+private
+string minimise(string text, string mode, int count)
+{
+   string min;
+
+   while (count--)
+      min = XTERM256_D->minimise_sgr(text, mode);
+   return min;
+}
+
+private
+int bytes(string text)
+{
+   return sizeof(string_encode(text, "utf-8"));
+}
+
+string bench(int iterations)
+{
+   mapping samples;
+   string ret = "";
+
+   if (iterations <= 0)
+      iterations = 100;
+   if (!this_body())
+      return "Run the benchmark as a player; the samples use your body and colours.\n";
+
+   samples = (["who":load_object("/cmds/player/who")->get_who_string(0),
+               "score":load_object("/cmds/player/score")->get_score_string(this_body(), "Score"),
+               "frames":frames_sample(), "combat":combat_sample()]);
+
+   ret = sprintf("SGR minimiser benchmark, %d passes per sample\n%-8s %-6s %10s %10s %7s %10s\n", iterations,
+                 "sample", "mode", "before", "after", "saved", "time");
+   foreach (string name in ({"who", "score", "frames", "combat"}))
+   {
+      foreach (string mode in MODES)
+      {
+         string text = substitute(samples[name], mode);
+         string min;
+         int usecs = time_expression(min = minimise(text, mode, iterations));
+         int before = bytes(text), after = bytes(min);
+
+         ret += sprintf("%-8s %-6s %10d %10d %6d%% %8dus\n", name, mode, before, after,
+                        before ? (before - after) * 100 / before : 0, usecs);
+      }
+   }
+
+   return ret;
+}
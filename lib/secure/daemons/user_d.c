@@ -29,6 +29,18 @@
 **       because the save files for the user/body are read-protected.
 **       In both cases, privilege 1 is required to fulfill the request.
 **
+**
+**   object query_online_user(string userid, int even_linkdead)
+**   object query_online_body(string name, int even_linkdead)
+**   object *query_bodies_by_prefix(string prefix)
+**
+**     The online index behind find_user() and find_body().  User
+**     objects register when they get a body (login, reconnect and
+**     body switch), mark themselves link-dead from net_dead() and
+**     unregister from remove().  Bodies are indexed by userid and by
+**     their lowercased name and nickname; the names are also kept
+**     sorted for prefix matches.
+**
 ** 950823, Deathblade: created
 */
 
@@ -58,6 +70,17 @@ nosave private string *legal_body_set = ({
     "wiz_position",
 });
 
+/*
+** The online index.  Entries for objects destructed without remove()
+** read as 0 and are dropped when looked up.
+*/
+nosave private mapping online_users = ([]);  /* userid -> user */
+nosave private mapping online_bodies = ([]); /* userid -> body */
+nosave private mapping online_names = ([]);  /* lowercased name -> body */
+nosave private mapping body_names = ([]);    /* body -> names indexed */
+nosave private mapping linkdead = ([]);      /* userid -> time it went */
+nosave private string *sorted_names;         /* 0 when out of date */
+
 class var_info
 {
    object ob;
@@ -65,9 +88,13 @@ class var_info
    string *lines;
 }
 
+private
+nomask void index_online();
+
 void create()
 {
    set_privilege(1);
+   index_online();
    call_out("user_keepalive", 45);
 }
 
@@ -77,6 +104,221 @@ private void user_keepalive()
   call_out("user_keepalive", 45);
 }
 
+private
+nomask void unindex_body(object body)
+{
+   if (!body_names[body])
+      return;
+   foreach (string name in body_names[body])
+      if (online_names[name] == body)
+         map_delete(online_names, name);
+   map_delete(body_names, body);
+   sorted_names = 0;
+}
+
+private
+nomask void index_body(object body)
+{
+   string *names = ({});
+   string name;
+
+   unindex_body(body);
+   if (name = body->living_query_name())
+      names += ({lower_case(name)});
+   if ((name = body->query_nickname()) && member_array(lower_case(name), names) == -1)
+      names += ({lower_case(name)});
+   foreach (name in names)
+      online_names[name] = body;
+   body_names[body] = names;
+   sorted_names = 0;
+}
+
+private
+nomask void drop_user(string userid)
+{
+   if (online_bodies[userid])
+      unindex_body(online_bodies[userid]);
+   map_delete(online_users, userid);
+   map_delete(online_bodies, userid);
+   map_delete(linkdead, userid);
+}
+
+private
+nomask int connected(object body)
+{
+   object user = body->query_link();
+
+   return user && !linkdead[user->query_userid()];
+}
+
+private
+nomask object caller_user()
+{
+   object user = previous_object();
+
+   if (base_name(user) != USER_OB)
+      error("illegal attempt to change the online index\n");
+   return user;
+}
+
+/*
+** The index lives in memory only, so a freshly loaded USER_D finds the
+** users that are already on from their objects.
+*/
+private
+nomask void index_online()
+{
+   foreach (object user in children(USER_OB))
+   {
+      string userid;
+      object body;
+
+      if (!clonep(user) || !(userid = user->query_userid()) || !(body = user->query_body()))
+         continue;
+      online_users[userid] = user;
+      online_bodies[userid] = body;
+      index_body(body);
+      if (!interactive(user))
+         linkdead[userid] = time();
+   }
+}
+
+//: FUNCTION register_body
+// Called by the user object once it has a body: after login, reconnecting
+// and switching bodies.  (Re)indexes the user and its body.
+nomask void register_body()
+{
+   object user = caller_user();
+   string userid = user->query_userid();
+   object body = user->query_body();
+
+   if (!userid)
+      return;
+   if (online_bodies[userid] && online_bodies[userid] != body)
+      unindex_body(online_bodies[userid]);
+   online_users[userid] = user;
+   map_delete(linkdead, userid);
+   if (body)
+   {
+      online_bodies[userid] = body;
+      index_body(body);
+   }
+   else
+      map_delete(online_bodies, userid);
+}
+
+//: FUNCTION register_linkdead
+// Called by the user object from net_dead().
+nomask void register_linkdead()
+{
+   object user = caller_user();
+   string userid = user->query_userid();
+
+   if (userid && online_users[userid] == user)
+      linkdead[userid] = time();
+}
+
+//: FUNCTION unregister_user
+// Called by the user object from remove().  A user object that was
+// replaced by a reconnect leaves the new one's entry alone.
+nomask void unregister_user()
+{
+   object user = caller_user();
+   string userid = user->query_userid();
+
+   if (userid && online_users[userid] == user)
+      drop_user(userid);
+}
+
+//: FUNCTION refresh_body_names
+// Called by a body whose name or nickname changed.
+nomask void refresh_body_names()
+{
+   object body = previous_object();
+
+   if (body_names[body])
+      index_body(body);
+}
+
+//: FUNCTION query_online_user
+// Returns the user object logged in as userid, or 0.  Link-dead users are
+// only returned if even_linkdead is set.
+varargs nomask object query_online_user(string userid, int even_linkdead)
+{
+   object user = online_users[userid];
+
+   if (!user)
+   {
+      if (userid && !undefinedp(online_users[userid]))
+         drop_user(userid);
+      return 0;
+   }
+   if (!even_linkdead && linkdead[userid])
+      return 0;
+   return user;
+}
+
+//: FUNCTION query_online_body
+// Returns the body of the user logged in as name, or else the body with
+// that name or nickname, or 0.  Bodies of link-dead users are only
+// returned if even_linkdead is set.
+varargs nomask object query_online_body(string name, int even_linkdead)
+{
+   object body;
+
+   if (!name)
+      return 0;
+   if (!(body = online_bodies[name]) && !(body = online_names[lower_case(name)]))
+      return 0;
+   if (!even_linkdead && !connected(body))
+      return 0;
+   return body;
+}
+
+//: FUNCTION query_bodies_by_prefix
+// Returns the online bodies whose name or nickname starts with prefix,
+// ignoring case.  Link-dead users are left out.
+nomask object *query_bodies_by_prefix(string prefix)
+{
+   object *found = ({});
+   int lo, hi, mid;
+   int len;
+
+   if (!prefix || prefix == "")
+      return found;
+   prefix = lower_case(prefix);
+   len = strlen(prefix);
+   if (!sorted_names)
+      sorted_names = sort_array(keys(online_names), 1);
+
+   /* Binary search for the first name >= prefix */
+   hi = sizeof(sorted_names);
+   while (lo < hi)
+   {
+      mid = (lo + hi) / 2;
+      if (sorted_names[mid] < prefix)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   for (; lo < sizeof(sorted_names) && sorted_names[lo][0..len - 1] == prefix; lo++)
+   {
+      object body = online_names[sorted_names[lo]];
+
+      if (body && member_array(body, found) == -1 && connected(body))
+         found += ({body});
+   }
+   return found;
+}
+
+//: FUNCTION query_online_stats
+// Sizes of the online index.
+nomask mapping query_online_stats()
+{
+   return (["users":sizeof(online_users), "bodies":sizeof(online_bodies), "names":sizeof(online_names),
+            "linkdead":sizeof(linkdead)]);
+}
+
 private
 nomask mixed query_online_object(object ob, string varname)
 {
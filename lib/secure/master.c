@@ -16,30 +16,66 @@ inherit __DIR__ "error_handler.c";
 private
 mapping errors = ([]);
 
-object compile_object(string path)
-{
-   string pname;
-   object ob;
+/* Directory -> the virtual servers that could make objects in it, deepest
+ * first, as found by compile_object().  An empty array means there are
+ * none.  Emptied by valid_write() when a .c file is created or removed. */
+private
+nosave mapping virtual_servers = ([]);
+private
+nosave int virtual_hits, virtual_misses;
 
-   pname = path;
+/* go back through the path, checking each dir; if the name is
+  "/foo/bar/baz.c" then "/foo/bar.c" and "/foo.c" are checked. */
+private
+string *find_virtual_servers(string dir)
+{
+   string *servers = ({});
+   string pname = dir;
+   int idx;
 
-   /* go back through the path, checking each dir; if the name is
-     "/foo/bar/baz.c" then "/foo/bar.c" and "/foo.c" are checked. */
    while (1)
    {
-      int idx = strsrch(pname, "/", -1);
+      if (file_size(pname + ".c") >= 0)
+         servers += ({pname});
+      idx = strsrch(pname, "/", -1);
+      if (idx <= 0)
+         return servers;
+      pname = pname[0..idx - 1];
+   }
+}
 
-      if (idx == -1)
-         return 0;
+object compile_object(string path)
+{
+   int idx = strsrch(path, "/", -1);
+   string dir;
+   string *servers;
+   object ob;
 
-      pname = pname[0..idx - 1];
+   if (idx <= 0)
+      return 0;
+   dir = path[0..idx - 1];
+   if (servers = virtual_servers[dir])
+      virtual_hits++;
+   else
+   {
+      virtual_misses++;
+      servers = virtual_servers[dir] = find_virtual_servers(dir);
+   }
 
-      if (file_size(pname + ".c") >= 0)
-      {
-         if (ob = pname->virtual_create(path[idx + 1..]))
-            return ob;
-      }
+   foreach (string pname in servers)
+   {
+      if (ob = pname->virtual_create(path[strlen(pname) + 1..]))
+         return ob;
    }
+   return 0;
+}
+
+//: FUNCTION query_virtual_stats
+// Returns how often compile_object() found the virtual servers for a
+// directory in its cache, and how many directories are cached.
+mapping query_virtual_stats()
+{
+   return (["hits":virtual_hits, "misses":virtual_misses, "directories":sizeof(virtual_servers)]);
 }
 
 private
@@ -637,7 +673,12 @@ mixed valid_write(mixed path, object caller, string call_fun)
    path = canonical_path(path);
 
    if (SECURE_D->check_privilege(SECURE_D->query_protection(path, 1), 1))
+   {
+      /* A virtual server may be appearing or going away */
+      if (path[ < 2..] == ".c" && (call_fun == "rm" || call_fun == "rename" || file_size(path) < 0))
+         virtual_servers = ([]);
       return path;
+   }
 
    write_file(ACCESS_LOG,
               (this_user() ? this_user()->query_userid() : file_name(caller)) + ": attempted to write " + path + "\n");
@@ -13,12 +13,28 @@
  * string json_encode(mixed value)
  *     Serializes an LPC value into JSON text.
  *
+ * varargs mixed *json_decode_begin(string text, int more)
+ * varargs void json_decode_feed(mixed *state, string text, int last)
+ * varargs int json_decode_step(mixed *state, int budget)
+ * mixed json_decode_result(mixed *state)
+ *     Incremental decoding.  json_decode_step() decodes at most <budget>
+ *     tokens and returns JSON_DONE, JSON_PENDING or JSON_NEED_INPUT (see
+ *     <json.h>), so that a large document, or one arriving in pieces from
+ *     a socket, can be decoded over several executions.
+ *
+ * varargs void json_decode_async(string text, function callback, int budget)
+ *     Decodes <text> a slice at a time from call_outs, then calls
+ *     callback(value, error).
+ *
  * v1.0: initial release
  * v1.0.1: fix for handling of \uXXXX on FLUFFOS
  * v1.0.2: define array keyword for LDMud & use it consistently
  * v1.0.3: fix for empty data structures
  * v1.0.4: Removed array keyword. (Yucong Sun)
  * v1.0.5: Fix decoding number 0.
+ * v2.0: The encoder collects its output into a parts array joined once and
+ *       detects cycles with a mapping.  The decoder is a single pass,
+ *       non-recursive tokenizer that can be suspended and resumed.
  *
  * LICENSE
  *
@@ -47,50 +63,46 @@
 #ifndef __STD_JSON_H
 #define __STD_JSON_H
 
-#define to_string(x)                ("" + (x))
-
-#define JSON_DECODE_PARSE_TEXT      0
-#define JSON_DECODE_PARSE_POS       1
-#define JSON_DECODE_PARSE_LINE      2
-#define JSON_DECODE_PARSE_CHAR      3
-#define JSON_DECODE_PARSE_FIELDS    4
+#include <json.h>
 
-private mixed json_decode_parse_value(mixed* parse);
-private varargs mixed json_decode_parse_string(mixed* parse, int initiator_checked);
+#define to_string(x)                ("" + (x))
 
-private void json_decode_parse_next_char(mixed* parse) {
-    parse[JSON_DECODE_PARSE_POS]++;
-    parse[JSON_DECODE_PARSE_CHAR]++;
-}
+#define JSON_DECODE_BUF             0
+#define JSON_DECODE_POS             1
+#define JSON_DECODE_LINE            2
+#define JSON_DECODE_LINE_START      3
+#define JSON_DECODE_EXPECT          4
+#define JSON_DECODE_STACK           5
+#define JSON_DECODE_DEPTH           6
+#define JSON_DECODE_RESULT          7
+#define JSON_DECODE_FINAL           8
+#define JSON_DECODE_ESCAPE          9
+#define JSON_DECODE_FIELDS          10
 
-private void json_decode_parse_next_chars(mixed* parse, int num) {
-    parse[JSON_DECODE_PARSE_POS] += num;
-    parse[JSON_DECODE_PARSE_CHAR] += num;
-}
+// An open array or object on the decode stack.  Arrays are grown by
+// doubling and trimmed to JSON_FRAME_COUNT when they are closed.
+#define JSON_FRAME_VALUE            0
+#define JSON_FRAME_COUNT            1
+#define JSON_FRAME_KEY              2
+#define JSON_FRAME_FIELDS           3
 
-private void json_decode_parse_next_line(mixed* parse) {
-    parse[JSON_DECODE_PARSE_POS]++;
-    parse[JSON_DECODE_PARSE_LINE]++;
-    parse[JSON_DECODE_PARSE_CHAR] = 1;
-}
+#define JSON_EXPECT_VALUE           0
+#define JSON_EXPECT_VALUE_OR_CLOSE  1
+#define JSON_EXPECT_KEY             2
+#define JSON_EXPECT_KEY_OR_CLOSE    3
+#define JSON_EXPECT_COLON           4
+#define JSON_EXPECT_COMMA_OR_CLOSE  5
+#define JSON_EXPECT_END             6
+#define JSON_EXPECT_DONE            7
 
-private void json_decode_skip_whitespaces(mixed* parse) {
-    int ch;
-    while(1) {
-      json_decode_parse_next_char(parse);
-      ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-      if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t') {
-        continue;
-      } else {
-        return ;
-      }
-    }
-}
+#define JSON_ENCODE_PARTS           0
+#define JSON_ENCODE_COUNT           1
+#define JSON_ENCODE_SEEN            2
+#define JSON_ENCODE_FIELDS          3
 
 private int json_decode_hexdigit(int ch) {
     switch(ch) {
     case '0'    :
-        return 0;
     case '1'    :
     case '2'    :
     case '3'    :
@@ -102,545 +114,526 @@ private int json_decode_hexdigit(int ch) {
     case '9'    :
         return ch - '0';
     case 'a'    :
-    case 'A'    :
-        return 10;
     case 'b'    :
-    case 'B'    :
-        return 11;
     case 'c'    :
-    case 'C'    :
-        return 12;
     case 'd'    :
-    case 'D'    :
-        return 13;
     case 'e'    :
-    case 'E'    :
-        return 14;
     case 'f'    :
+        return ch - 'a' + 10;
+    case 'A'    :
+    case 'B'    :
+    case 'C'    :
+    case 'D'    :
+    case 'E'    :
     case 'F'    :
-        return 15;
+        return ch - 'A' + 10;
     }
     return -1;
 }
 
-private varargs int json_decode_parse_at_token(mixed* parse, string token, int start) {
-    int i, j;
-    for(i = start, j = strlen(token); i < j; i++)
-        if(parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS] + i] != token[i])
-            return 0;
-    return 1;
-}
-
 private varargs void json_decode_parse_error(mixed* parse, string msg, int ch) {
     if(ch)
         msg = sprintf("%s, '%c'", msg, ch);
-    msg = sprintf("%s @ line %d char %d\n", msg, parse[JSON_DECODE_PARSE_LINE], parse[JSON_DECODE_PARSE_CHAR]);
+    msg = sprintf("%s @ line %d char %d\n", msg, parse[JSON_DECODE_LINE],
+                  parse[JSON_DECODE_POS] - parse[JSON_DECODE_LINE_START] + 1);
     error(msg);
 }
 
-private mixed json_decode_parse_object(mixed* parse) {
-    mapping out = ([]);
-    int done = 0;
-    mixed key, value;
-    int found_non_whitespace, found_sep, found_comma;
-    json_decode_parse_next_char(parse);
-    if(parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]] == '}') {
-        done = 1;
-        json_decode_parse_next_char(parse);
-    }
-    while(!done) {
-        found_non_whitespace = 0;
-        while(!found_non_whitespace) {
-            switch(parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]]) {
-            case 0      :
-                json_decode_parse_error(parse, "Unexpected end of data");
-            case ' '    :
-            case '\t'   :
-            case '\r'   :
-                json_decode_parse_next_char(parse);
-                break;
-            case 0x0c   :
-            case '\n'   :
-                json_decode_parse_next_line(parse);
-                break;
-            default     :
-                found_non_whitespace = 1;
-                break;
-            }
-        }
-        key = json_decode_parse_string(parse);
-        found_sep = 0;
-        while(!found_sep) {
-            int ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-            switch(ch) {
-            case 0      :
-                json_decode_parse_error(parse, "Unexpected end of data");
-            case ':'    :
-                found_sep = 1;
-                json_decode_parse_next_char(parse);
-                break;
-            case ' '    :
-            case '\t'   :
-            case '\r'   :
-                json_decode_parse_next_char(parse);
-                break;
-            case 0x0c   :
-            case '\n'   :
-                json_decode_parse_next_line(parse);
-                break;
-            default     :
-                json_decode_parse_error(parse, "Unexpected character", ch);
-            }
+// Returns the offset just past the closing quote of the string whose
+// opening quote is at <pos>, or -1 if the buffer ends first.  The offset of
+// the first backslash (or -1) is left in parse[JSON_DECODE_ESCAPE].
+private int json_decode_string_end(mixed* parse, buffer buf, int len, int pos) {
+    int ch;
+    int esc = -1;
+    for(pos++; pos < len; pos++) {
+        ch = buf[pos];
+        if(ch == '"') {
+            parse[JSON_DECODE_ESCAPE] = esc;
+            return pos + 1;
         }
-        value = json_decode_parse_value(parse);
-        found_comma = 0;
-        while(!found_comma && !done) {
-            int ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-            switch(ch) {
-            case 0      :
-                json_decode_parse_error(parse, "Unexpected end of data");
-            case ','    :
-                found_comma = 1;
-                json_decode_parse_next_char(parse);
-                break;
-            case '}'    :
-                done = 1;
-                json_decode_parse_next_char(parse);
-                break;
-            case ' '    :
-            case '\t'   :
-            case '\r'   :
-                json_decode_parse_next_char(parse);
-                break;
-            case 0x0c   :
-            case '\n'   :
-                json_decode_parse_next_line(parse);
-                break;
-            default     :
-                json_decode_parse_error(parse, "Unexpected character", ch);
-            }
+        if(ch == '\\') {
+            if(esc == -1)
+                esc = pos;
+            pos++;
         }
-        out[key] = value;
     }
-    return out;
+    return -1;
 }
 
-private mixed json_decode_parse_array(mixed* parse) {
-    mixed* out = ({});
-    int done = 0;
-    int found_comma;
-    json_decode_parse_next_char(parse);
-    if(parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]] == ']') {
-        done = 1;
-        json_decode_parse_next_char(parse);
+private int json_decode_hex4(mixed* parse, buffer buf, int pos, int to) {
+    int value, digit;
+    if(pos + 4 > to)
+        json_decode_parse_error(parse, "Invalid string, truncated \\u escape");
+    for(int i = pos; i < pos + 4; i++) {
+        if((digit = json_decode_hexdigit(buf[i])) == -1)
+            json_decode_parse_error(parse, "Invalid hex digit", buf[i]);
+        value = (value << 4) | digit;
     }
-    while(!done) {
-        mixed value = json_decode_parse_value(parse);
-        found_comma = 0;
-        while(!found_comma && !done) {
-            int ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-            switch(ch) {
-            case 0      :
-                json_decode_parse_error(parse, "Unexpected end of data");
-            case ','    :
-                found_comma = 1;
-                json_decode_parse_next_char(parse);
-                break;
-            case ']'    :
-                done = 1;
-                json_decode_parse_next_char(parse);
-                break;
-            case ' '    :
-            case '\t'   :
-            case '\r'   :
-                json_decode_parse_next_char(parse);
-                break;
-            case 0x0c   :
-            case '\n'   :
-                json_decode_parse_next_line(parse);
-                break;
-            default     :
-                json_decode_parse_error(parse, "Unexpected character", ch);
-            }
-        }
-        out += ({ value });
-    }
-    return out;
+    return value;
 }
 
-private varargs mixed json_decode_parse_string(mixed* parse, int initiator_checked) {
-    int from, to, esc_state, esc_active;
-    string out;
-    if(!initiator_checked) {
-        int ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-        if(!ch)
-            json_decode_parse_error(parse, "Unexpected end of data");
-        if(ch != '"')
-            json_decode_parse_error(parse, "Unexpected character", ch);
-    }
-    json_decode_parse_next_char(parse);
-    from = parse[JSON_DECODE_PARSE_POS];
-    to = -1;
-    esc_state = 0;
-    esc_active = 0;
-    while(to == -1) {
-        switch(parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]]) {
-        case 0          :
-            json_decode_parse_error(parse, "Unexpected end of data");
-        case '\\'       :
-            esc_state = !esc_state;
+// Decodes the string body buf[from .. to - 1], whose first backslash is at
+// <esc>.  Unescaped runs are decoded straight from the buffer.
+private string json_decode_unescape(mixed* parse, buffer buf, int from, int to, int esc) {
+    string* parts = ({});
+    int ch, cp, low;
+
+    while(esc != -1) {
+        if(esc > from)
+            parts += ({ string_decode(buf[from .. esc - 1], "utf-8") });
+        ch = buf[esc + 1];
+        from = esc + 2;
+        switch(ch) {
+        case '"'    :
+            parts += ({ "\"" });
             break;
-        case '"'        :
-            if(esc_state) {
-                esc_state = 0;
-                esc_active++;
-            } else {
-                to = parse[JSON_DECODE_PARSE_POS] - 1;
-            }
+        case '\\'   :
+            parts += ({ "\\" });
+            break;
+        case '/'    :
+            parts += ({ "/" });
             break;
-        default         :
-            if(esc_state) {
-                esc_state = 0;
-                esc_active++;
+        case 'b'    :
+            parts += ({ "\b" });
+            break;
+        case 'f'    :
+            parts += ({ "\x0c" });
+            break;
+        case 'n'    :
+            parts += ({ "\n" });
+            break;
+        case 'r'    :
+            parts += ({ "\r" });
+            break;
+        case 't'    :
+            parts += ({ "\t" });
+            break;
+        case 'u'    :
+            cp = json_decode_hex4(parse, buf, from, to);
+            from += 4;
+            if((cp & 0xfffff800) == 0xd800) {
+                // UTF-16 surrogate; the low half must follow
+                if(from + 6 > to || buf[from] != '\\' || buf[from + 1] != 'u')
+                    json_decode_parse_error(parse, "Invalid string, missing surrogate pair");
+                low = json_decode_hex4(parse, buf, from + 2, to);
+                cp = 0x10000 + (cp - 0xd800) * 0x400 + (low - 0xdc00);
+                from += 6;
             }
+            parts += ({ sprintf("%c", cp) });
             break;
+        default     :
+            json_decode_parse_error(parse, "Invalid escape", ch);
         }
-        json_decode_parse_next_char(parse);
+        for(esc = from; esc < to && buf[esc] != '\\'; esc++)
+            ;
+        if(esc >= to)
+            esc = -1;
     }
-    out = string_decode(parse[JSON_DECODE_PARSE_TEXT][from .. to], "utf-8");
-    if(esc_active) {
-        if(member_array('"', out) != -1)
-            out = replace_string(out, "\\\"", "\"");
-        if(strsrch(out, "\\b") != -1)
-            out = replace_string(out, "\\b", "\b");
-        if(strsrch(out, "\\f") != -1)
-            out = replace_string(out, "\\f", "\x0c");
-        if(strsrch(out, "\\n") != -1)
-            out = replace_string(out, "\\n", "\n");
-        if(strsrch(out, "\\r") != -1)
-            out = replace_string(out, "\\r", "\r");
-        if(strsrch(out, "\\t") != -1)
-            out = replace_string(out, "\\t", "\t");
-        if(strsrch(out, "\\u") != -1) {
-          for (int i = 0; i< strlen(out); i++) {
-            if (out[i] == '\\' && out[i+1] == 'u') {
-              int* nybbles = allocate(4);
-              int character = 0;
-              i += 2;
-              for(int k = 0; k < 4; k++) {
-                if((nybbles[k] = json_decode_hexdigit(out[i + k])) == -1)
-                  json_decode_parse_error(parse, "Invalid hex digit", out[i + k]);
-              }
-              character = (nybbles[0] << 12) | (nybbles[1] << 8 )| (nybbles[2] << 4) | nybbles[3];
-              // Single codepoint character
-              if (!(((character)&0xfffff800)==0xd800)) {
-                i -= 2;
-                out[i .. i + 2 + 4 - 1] = sprintf("%c", character);
-                i = 0;
-                continue;
-              } else {
-                // UTF16 - Surrogate, attempts to parse the second value
-                int codepoint;
-                int next_character = 0;
-                int* nybbles2 = allocate(4);
-                i += 4;
-                if (out[i .. i+1] != "\\u") json_decode_parse_error(parse, "Invalid string, missing surrogate pair");
-                i += 2;
-                for(int k = 0; k < 4; k++) {
-                  if((nybbles2[k] = json_decode_hexdigit(out[i + k])) == -1)
-                    json_decode_parse_error(parse, "Invalid hex digit", out[i + k]);
-                }
-                next_character = (nybbles2[0] << 12) | (nybbles2[1] << 8) | (nybbles2[2] << 4) | (nybbles2[3]);
-                i -= 2 + 4 + 2; // reset to first \u
-                codepoint = 0x10000 + (character - 0xd800) * 0x400 + (next_character - 0xDC00);
-                out[i .. i + 2 + 4 + 2 + 4 - 1] = sprintf("%c", codepoint);
-                i = 0;
-                continue;
-              }
-            }
-          }
+    if(to > from)
+        parts += ({ string_decode(buf[from .. to - 1], "utf-8") });
+    return implode(parts, "");
+}
+
+// Returns the offset just past the number starting at <pos>, or -1 if the
+// buffer ends before the number is known to be complete.
+private int json_decode_number_end(mixed* parse, buffer buf, int len, int pos) {
+    int final = parse[JSON_DECODE_FINAL];
+
+    if(buf[pos] == '-')
+        pos++;
+    if(pos >= len) {
+        if(!final)
+            return -1;
+        json_decode_parse_error(parse, "Unexpected end of data");
+    }
+    if(buf[pos] == '0') {
+        pos++;
+    } else if(buf[pos] >= '1' && buf[pos] <= '9') {
+        while(pos < len && buf[pos] >= '0' && buf[pos] <= '9')
+            pos++;
+    } else {
+        parse[JSON_DECODE_POS] = pos;
+        json_decode_parse_error(parse, "Unexpected character", buf[pos]);
+    }
+    if(pos < len && buf[pos] == '.') {
+        pos++;
+        if(pos < len && (buf[pos] < '0' || buf[pos] > '9')) {
+            parse[JSON_DECODE_POS] = pos;
+            json_decode_parse_error(parse, "Unexpected character", buf[pos]);
+        }
+        while(pos < len && buf[pos] >= '0' && buf[pos] <= '9')
+            pos++;
+    }
+    if(pos < len && (buf[pos] == 'e' || buf[pos] == 'E')) {
+        pos++;
+        if(pos < len && (buf[pos] == '+' || buf[pos] == '-'))
+            pos++;
+        if(pos < len && (buf[pos] < '0' || buf[pos] > '9')) {
+            parse[JSON_DECODE_POS] = pos;
+            json_decode_parse_error(parse, "Unexpected character", buf[pos]);
         }
-        if(member_array('/', out) != -1)
-            out = replace_string(out, "\\/", "/");
-        if(member_array('\\', out) != -1)
-            out = replace_string(out, "\\\\", "\\");
+        while(pos < len && buf[pos] >= '0' && buf[pos] <= '9')
+            pos++;
+    }
+    if(pos >= len) {
+        if(!final)
+            return -1;
+        if(buf[pos - 1] < '0' || buf[pos - 1] > '9')
+            json_decode_parse_error(parse, "Unexpected end of data");
     }
-    return out;
+    return pos;
 }
 
-private mixed json_decode_parse_number(mixed* parse) {
-    int from = parse[JSON_DECODE_PARSE_POS];
-    int to = -1;
-    int dot = -1;
-    int exp = -1;
-    int ch;
-    int next_ch;
-    string number;
-
-    ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-    if (ch == '-') {
-        next_ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS] + 1];
-        if(!next_ch) json_decode_parse_error(parse, "Unexpected end of data");
-        if(next_ch < '0' || next_ch > '9')
-            json_decode_parse_error(parse, "Unexpected character", next_ch);
-        json_decode_parse_next_char(parse);
+// Returns 1 if <token> is at <pos>, 0 if the buffer ends inside a possible
+// match; anything else is an error.
+private int json_decode_at_token(mixed* parse, buffer buf, int len, int pos, string token) {
+    int i, j;
+    for(i = 0, j = strlen(token); i < j; i++) {
+        if(pos + i >= len) {
+            if(parse[JSON_DECODE_FINAL])
+                json_decode_parse_error(parse, "Unexpected end of data");
+            return 0;
+        }
+        if(buf[pos + i] != token[i])
+            json_decode_parse_error(parse, "Unexpected character", buf[pos]);
     }
+    return 1;
+}
+
+varargs mixed* json_decode_begin(string text, int more) {
+    mixed* parse = allocate(JSON_DECODE_FIELDS);
+
+    parse[JSON_DECODE_BUF] = string_encode(text || "", "utf-8");
+    parse[JSON_DECODE_LINE] = 1;
+    parse[JSON_DECODE_EXPECT] = JSON_EXPECT_VALUE;
+    parse[JSON_DECODE_STACK] = allocate(8);
+    parse[JSON_DECODE_FINAL] = !more;
+    return parse;
+}
+
+// Appends more text to a decode started with json_decode_begin(text, 1).
+// Input that has already been consumed is discarded.
+varargs void json_decode_feed(mixed* parse, string text, int last) {
+    int pos = parse[JSON_DECODE_POS];
+
+    if(parse[JSON_DECODE_FINAL])
+        error("json_decode_feed: input has already ended\n");
+    parse[JSON_DECODE_BUF] = parse[JSON_DECODE_BUF][pos ..] + string_encode(text || "", "utf-8");
+    parse[JSON_DECODE_LINE_START] -= pos;
+    parse[JSON_DECODE_POS] = 0;
+    parse[JSON_DECODE_FINAL] = last;
+}
+
+mixed json_decode_result(mixed* parse) {
+    return parse[JSON_DECODE_RESULT];
+}
+
+// Decodes up to <budget> tokens (all of them if <budget> is 0).
+varargs int json_decode_step(mixed* parse, int budget) {
+    buffer buf = parse[JSON_DECODE_BUF];
+    int len = sizeof(buf);
+    int pos = parse[JSON_DECODE_POS];
+    int expect = parse[JSON_DECODE_EXPECT];
+    mixed* stack = parse[JSON_DECODE_STACK];
+    int depth = parse[JSON_DECODE_DEPTH];
+    int unlimited = budget <= 0;
+    int ch, end, have_value;
+    mixed value;
+    mixed* frame;
+
+    if(expect == JSON_EXPECT_DONE)
+        return JSON_DONE;
 
-    ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-    if (ch == '0') {
-        // 0 can only either be an direct int value 0, or 0e or 0E
-        next_ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS] + 1];
-        // 0 before EOF
-        if(next_ch == 0) {
-          json_decode_parse_next_char(parse);
-          return 0;
+    while(unlimited || budget-- > 0) {
+        while(pos < len) {
+            ch = buf[pos];
+            if(ch == ' ' || ch == '\t' || ch == '\r') {
+                pos++;
+            } else if(ch == '\n' || ch == 0x0c) {
+                pos++;
+                parse[JSON_DECODE_LINE]++;
+                parse[JSON_DECODE_LINE_START] = pos;
+            } else {
+                break;
+            }
         }
-        // only valid char here are .eE, continue parse
-        if (next_ch == '.' || next_ch == 'e' || next_ch == 'E') {
-          json_decode_parse_next_char(parse);
-        } else {
-          // consume until next non-whitespace
-          json_decode_skip_whitespaces(parse);
-          next_ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-          // can not continue to be number.
-          if ((next_ch >= '0' && next_ch <= '9') || next_ch == '-') json_decode_parse_error(parse, "Unexpected character", next_ch);
-          return 0;
+
+        parse[JSON_DECODE_POS] = pos;
+        parse[JSON_DECODE_EXPECT] = expect;
+        parse[JSON_DECODE_STACK] = stack;
+        parse[JSON_DECODE_DEPTH] = depth;
+
+        if(pos >= len) {
+            if(!parse[JSON_DECODE_FINAL])
+                return JSON_NEED_INPUT;
+            if(expect != JSON_EXPECT_END)
+                json_decode_parse_error(parse, "Unexpected end of data");
+            parse[JSON_DECODE_EXPECT] = JSON_EXPECT_DONE;
+            return JSON_DONE;
         }
-    }
-    while(to == -1) {
-        ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-        switch(ch) {
-        case '.'        :
-            if(dot != -1 || exp != -1)
-                json_decode_parse_error(parse, "Unexpected character", ch);
-            dot = parse[JSON_DECODE_PARSE_POS];
-            json_decode_parse_next_char(parse);
-            break;
-        case '0'        :
-        case '1'        :
-        case '2'        :
-        case '3'        :
-        case '4'        :
-        case '5'        :
-        case '6'        :
-        case '7'        :
-        case '8'        :
-        case '9'        :
-            json_decode_parse_next_char(parse);
-            break;
-        case 'e'        :
-        case 'E'        :
-            if(exp != -1)
-                json_decode_parse_error(parse, "Unexpected character", ch);
-            exp = parse[JSON_DECODE_PARSE_POS];
-            json_decode_parse_next_char(parse);
-            break;
-        case '-'        :
-        case '+'        :
-            if(exp == parse[JSON_DECODE_PARSE_POS] - 1) {
-                json_decode_parse_next_char(parse);
-                break;
+
+        ch = buf[pos];
+        frame = depth ? stack[depth - 1] : 0;
+
+        if(expect == JSON_EXPECT_COMMA_OR_CLOSE) {
+            if(ch == ',') {
+                pos++;
+                expect = mapp(frame[JSON_FRAME_VALUE]) ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+                continue;
             }
-            // Fallthrough
-        default         :
-            to = parse[JSON_DECODE_PARSE_POS] - 1;
-            if(dot == to || to < from)
+            if(ch != (mapp(frame[JSON_FRAME_VALUE]) ? '}' : ']'))
                 json_decode_parse_error(parse, "Unexpected character", ch);
-            break;
+            // Fall through to the close handling below.
+            expect = mapp(frame[JSON_FRAME_VALUE]) ? JSON_EXPECT_KEY_OR_CLOSE : JSON_EXPECT_VALUE_OR_CLOSE;
         }
-    }
-    number = string_decode(parse[JSON_DECODE_PARSE_TEXT][from .. to], "utf-8");
-    if(dot != -1 || exp != -1)
-        return to_float(number);
-    else
-        return to_int(number);
-}
 
-private mixed json_decode_parse_value(mixed* parse) {
-    for(;;) {
-        int ch;
-        ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-        switch(ch) {
-        case 0          :
-            json_decode_parse_error(parse, "Unexpected end of data");
-        case '{'        :
-            return json_decode_parse_object(parse);
-        case '['        :
-            return json_decode_parse_array(parse);
-        case '"'        :
-            return json_decode_parse_string(parse, 1);
-        case '-'        :
-        case '0'        :
-        case '1'        :
-        case '2'        :
-        case '3'        :
-        case '4'        :
-        case '5'        :
-        case '6'        :
-        case '7'        :
-        case '8'        :
-        case '9'        :
-            return json_decode_parse_number(parse);
-        case ' '        :
-        case '\t'       :
-        case '\r'       :
-            json_decode_parse_next_char(parse);
-            break;
-        case 0x0c       :
-        case '\n'       :
-            json_decode_parse_next_line(parse);
-            break;
-        case 't'        :
-            if(json_decode_parse_at_token(parse, "true", 1)) {
-                json_decode_parse_next_chars(parse, 4);
-                return 1;
-            } else {
+        if(expect == JSON_EXPECT_VALUE_OR_CLOSE && ch == ']') {
+            pos++;
+            value = frame[JSON_FRAME_VALUE][0 .. frame[JSON_FRAME_COUNT] - 1];
+            stack[--depth] = 0;
+            have_value = 1;
+        } else if(expect == JSON_EXPECT_KEY_OR_CLOSE && ch == '}') {
+            pos++;
+            value = frame[JSON_FRAME_VALUE];
+            stack[--depth] = 0;
+            have_value = 1;
+        } else if(expect == JSON_EXPECT_KEY || expect == JSON_EXPECT_KEY_OR_CLOSE) {
+            if(ch != '"')
                 json_decode_parse_error(parse, "Unexpected character", ch);
+            if((end = json_decode_string_end(parse, buf, len, pos)) == -1) {
+                if(parse[JSON_DECODE_FINAL])
+                    json_decode_parse_error(parse, "Unexpected end of data");
+                return JSON_NEED_INPUT;
             }
-        case 'f'        :
-            if(json_decode_parse_at_token(parse, "false", 1)) {
-                json_decode_parse_next_chars(parse, 5);
-                return 0;
-            } else {
+            if(end - pos == 2)
+                frame[JSON_FRAME_KEY] = "";
+            else if(parse[JSON_DECODE_ESCAPE] == -1)
+                frame[JSON_FRAME_KEY] = string_decode(buf[pos + 1 .. end - 2], "utf-8");
+            else
+                frame[JSON_FRAME_KEY] = json_decode_unescape(parse, buf, pos + 1, end - 1, parse[JSON_DECODE_ESCAPE]);
+            pos = end;
+            expect = JSON_EXPECT_COLON;
+        } else if(expect == JSON_EXPECT_COLON) {
+            if(ch != ':')
                 json_decode_parse_error(parse, "Unexpected character", ch);
-            }
-        case 'n'        :
-            if(json_decode_parse_at_token(parse, "null", 1)) {
-                json_decode_parse_next_chars(parse, 4);
-                return 0;
-            } else {
+            pos++;
+            expect = JSON_EXPECT_VALUE;
+        } else if(expect == JSON_EXPECT_END) {
+            json_decode_parse_error(parse, "Unexpected character", ch);
+        } else {
+            switch(ch) {
+            case '{'        :
+            case '['        :
+                if(depth == sizeof(stack))
+                    stack += allocate(depth);
+                frame = allocate(JSON_FRAME_FIELDS);
+                frame[JSON_FRAME_VALUE] = ch == '{' ? ([]) : allocate(8);
+                stack[depth++] = frame;
+                expect = ch == '{' ? JSON_EXPECT_KEY_OR_CLOSE : JSON_EXPECT_VALUE_OR_CLOSE;
+                pos++;
+                break;
+            case '"'        :
+                if((end = json_decode_string_end(parse, buf, len, pos)) == -1) {
+                    if(parse[JSON_DECODE_FINAL])
+                        json_decode_parse_error(parse, "Unexpected end of data");
+                    return JSON_NEED_INPUT;
+                }
+                if(end - pos == 2)
+                    value = "";
+                else if(parse[JSON_DECODE_ESCAPE] == -1)
+                    value = string_decode(buf[pos + 1 .. end - 2], "utf-8");
+                else
+                    value = json_decode_unescape(parse, buf, pos + 1, end - 1, parse[JSON_DECODE_ESCAPE]);
+                pos = end;
+                have_value = 1;
+                break;
+            case '-'        :
+            case '0'        :
+            case '1'        :
+            case '2'        :
+            case '3'        :
+            case '4'        :
+            case '5'        :
+            case '6'        :
+            case '7'        :
+            case '8'        :
+            case '9'        :
+                if((end = json_decode_number_end(parse, buf, len, pos)) == -1)
+                    return JSON_NEED_INPUT;
+                value = string_decode(buf[pos .. end - 1], "utf-8");
+                if(strsrch(value, '.') != -1 || strsrch(value, 'e') != -1 || strsrch(value, 'E') != -1)
+                    value = to_float(value);
+                else
+                    value = to_int(value);
+                pos = end;
+                have_value = 1;
+                break;
+            case 't'        :
+                if(!json_decode_at_token(parse, buf, len, pos, "true"))
+                    return JSON_NEED_INPUT;
+                value = 1;
+                pos += 4;
+                have_value = 1;
+                break;
+            case 'f'        :
+                if(!json_decode_at_token(parse, buf, len, pos, "false"))
+                    return JSON_NEED_INPUT;
+                value = 0;
+                pos += 5;
+                have_value = 1;
+                break;
+            case 'n'        :
+                if(!json_decode_at_token(parse, buf, len, pos, "null"))
+                    return JSON_NEED_INPUT;
+                value = 0;
+                pos += 4;
+                have_value = 1;
+                break;
+            default         :
                 json_decode_parse_error(parse, "Unexpected character", ch);
             }
-        default         :
-            json_decode_parse_error(parse, "Unexpected character", ch);
         }
-    }
-}
 
-private mixed json_decode_parse(mixed* parse) {
-    mixed out = json_decode_parse_value(parse);
-    for(;;) {
-        int ch = parse[JSON_DECODE_PARSE_TEXT][parse[JSON_DECODE_PARSE_POS]];
-        switch(ch) {
-        case 0          :
-            return out;
-        case ' '        :
-        case '\t'       :
-        case '\r'       :
-            json_decode_parse_next_char(parse);
-            break;
-        case 0x0c       :
-        case '\n'       :
-            json_decode_parse_next_line(parse);
-            break;
-        default         :
-            json_decode_parse_error(parse, "Unexpected character", ch);
+        if(have_value) {
+            have_value = 0;
+            if(!depth) {
+                parse[JSON_DECODE_RESULT] = value;
+                expect = JSON_EXPECT_END;
+            } else {
+                frame = stack[depth - 1];
+                if(mapp(frame[JSON_FRAME_VALUE])) {
+                    frame[JSON_FRAME_VALUE][frame[JSON_FRAME_KEY]] = value;
+                } else {
+                    end = frame[JSON_FRAME_COUNT]++;
+                    if(end == sizeof(frame[JSON_FRAME_VALUE]))
+                        frame[JSON_FRAME_VALUE] += allocate(end);
+                    frame[JSON_FRAME_VALUE][end] = value;
+                }
+                expect = JSON_EXPECT_COMMA_OR_CLOSE;
+            }
+            value = 0;
         }
     }
-    return 0;
+
+    parse[JSON_DECODE_POS] = pos;
+    parse[JSON_DECODE_EXPECT] = expect;
+    parse[JSON_DECODE_STACK] = stack;
+    parse[JSON_DECODE_DEPTH] = depth;
+    return JSON_PENDING;
 }
 
 mixed json_decode(string text) {
     mixed* parse;
-    buffer endl = allocate_buffer(1);
-    endl[0] = 0;
 
     if(!text) {
       return 0;
     }
 
-    parse = allocate(JSON_DECODE_PARSE_FIELDS);
-    parse[JSON_DECODE_PARSE_TEXT] = string_encode(text, "utf-8") + endl;
-    parse[JSON_DECODE_PARSE_POS] = 0;
-    parse[JSON_DECODE_PARSE_CHAR] = 1;
-    parse[JSON_DECODE_PARSE_LINE] = 1;
-    return json_decode_parse(parse);
+    parse = json_decode_begin(text);
+    json_decode_step(parse);
+    return parse[JSON_DECODE_RESULT];
 }
 
-varargs string json_encode(mixed value, mixed* pointers) {
-    if(undefinedp(value))
-        return "null";
-    if(intp(value) || floatp(value))
-        return to_string(value);
-    if(stringp(value)) {
-        if(member_array('"', value) != -1)
-            value = replace_string(value, "\"", "\\\"");
-        value = sprintf("\"%s\"", value);
-        if(member_array('\\', value) != -1) {
-            value = replace_string(value, "\\", "\\\\");
-            if(strsrch(value, "\\\"") != -1)
-                value = replace_string(value, "\\\"", "\"");
-        }
-        if(member_array('\b', value) != -1)
-            value = replace_string(value, "\b", "\\b");
-        if(member_array(0x0c, value) != -1)
-            value = replace_string(value, "\x0c", "\\f");
-        if(member_array('\n', value) != -1)
-            value = replace_string(value, "\n", "\\n");
-        if(member_array('\r', value) != -1)
-            value = replace_string(value, "\r", "\\r");
-        if(member_array('\t', value) != -1)
-            value = replace_string(value, "\t", "\\t");
-        if(member_array(0x1b, value) != -1)
-          value = replace_string(value, "\x1b", "\\u001b");
-
-        return value;
+private void json_decode_async_step(mixed* parse, function callback, int budget) {
+    int ret;
+    mixed err = catch(ret = json_decode_step(parse, budget));
+
+    if(err) {
+        evaluate(callback, 0, err);
+        return;
     }
-    if(mapp(value)) {
-        string out;
+    if(ret == JSON_PENDING) {
+        call_out((: json_decode_async_step, parse, callback, budget :), 0);
+        return;
+    }
+    evaluate(callback, parse[JSON_DECODE_RESULT], 0);
+}
+
+// Decodes <text> <budget> tokens at a time, yielding between slices so that
+// I3 mudlists and large HTTP payloads stay clear of the eval limit.
+varargs void json_decode_async(string text, function callback, int budget) {
+    json_decode_async_step(json_decode_begin(text), callback, budget > 0 ? budget : JSON_ASYNC_BUDGET);
+}
+
+private string json_encode_string(string value) {
+    if(member_array('\\', value) != -1)
+        value = replace_string(value, "\\", "\\\\");
+    if(member_array('"', value) != -1)
+        value = replace_string(value, "\"", "\\\"");
+    if(member_array('\b', value) != -1)
+        value = replace_string(value, "\b", "\\b");
+    if(member_array(0x0c, value) != -1)
+        value = replace_string(value, "\x0c", "\\f");
+    if(member_array('\n', value) != -1)
+        value = replace_string(value, "\n", "\\n");
+    if(member_array('\r', value) != -1)
+        value = replace_string(value, "\r", "\\r");
+    if(member_array('\t', value) != -1)
+        value = replace_string(value, "\t", "\\t");
+    if(member_array(0x1b, value) != -1)
+        value = replace_string(value, "\x1b", "\\u001b");
+    return "\"" + value + "\"";
+}
+
+private void json_encode_put(mixed* enc, string part) {
+    int n = enc[JSON_ENCODE_COUNT]++;
+    if(n == sizeof(enc[JSON_ENCODE_PARTS]))
+        enc[JSON_ENCODE_PARTS] += allocate(n);
+    enc[JSON_ENCODE_PARTS][n] = part;
+}
+
+private void json_encode_value(mixed* enc, mixed value) {
+    if(undefinedp(value)) {
+        json_encode_put(enc, "null");
+    } else if(intp(value) || floatp(value)) {
+        json_encode_put(enc, to_string(value));
+    } else if(stringp(value)) {
+        json_encode_put(enc, json_encode_string(value));
+    } else if(mapp(value) || arrayp(value)) {
+        mapping seen = enc[JSON_ENCODE_SEEN];
         int ix = 0;
-        if(pointers) {
-            // Don't recurse into circular data structures, output null for
-            // their interior reference
-            if(member_array(value, pointers) != -1)
-                return "null";
-            pointers += ({ value });
-        } else {
-            pointers = ({ value });
-        }
-        foreach(mixed k, mixed v in value) {
-            // Non-string keys are skipped because the JSON spec requires that
-            // object field names be strings.
-            if(!stringp(k))
-                continue;
-            if(ix++)
-                out = sprintf("%s,%s:%s", out, json_encode(k, pointers), json_encode(v, pointers));
-            else
-                out = sprintf("%s:%s", json_encode(k, pointers), json_encode(v, pointers));
+
+        // Don't recurse into circular data structures, output null for
+        // their interior reference
+        if(seen[value]) {
+            json_encode_put(enc, "null");
+            return;
         }
-        if(!out || out == "")
-            return "{}";
-        return sprintf("{%s}", out);
-    }
-    if(arrayp(value))
-    {
-        if(sizeof(value)) {
-            string out;
-            int ix = 0;
-            if(pointers) {
-                // Don't recurse into circular data structures, output null for
-                // their interior reference
-                if(member_array(value, pointers) != -1)
-                    return "null";
-                pointers += ({ value });
-            } else {
-                pointers = ({ value });
+        seen[value] = 1;
+        if(mapp(value)) {
+            json_encode_put(enc, "{");
+            foreach(mixed k, mixed v in value) {
+                // Non-string keys are skipped because the JSON spec requires
+                // that object field names be strings.
+                if(!stringp(k))
+                    continue;
+                json_encode_put(enc, (ix++ ? "," : "") + json_encode_string(k) + ":");
+                json_encode_value(enc, v);
             }
-            foreach(mixed v in value)
-                if(ix++)
-                    out = sprintf("%s,%s", out, json_encode(v, pointers));
-                else
-                    out = json_encode(v, pointers);
-
-            if(!out || out == "")
-                return "[]";
-            return sprintf("[%s]", out);
+            json_encode_put(enc, "}");
         } else {
-            return "[]";
+            json_encode_put(enc, "[");
+            foreach(mixed v in value) {
+                if(ix++)
+                    json_encode_put(enc, ",");
+                json_encode_value(enc, v);
+            }
+            json_encode_put(enc, "]");
         }
+        map_delete(seen, value);
+    } else {
+        // Values that cannot be represented in JSON are replaced by nulls.
+        json_encode_put(enc, "null");
     }
-    // Values that cannot be represented in JSON are replaced by nulls.
-    return "null";
+}
+
+string json_encode(mixed value) {
+    mixed* enc = allocate(JSON_ENCODE_FIELDS);
+
+    enc[JSON_ENCODE_PARTS] = allocate(64);
+    enc[JSON_ENCODE_SEEN] = ([]);
+    json_encode_value(enc, value);
+    return implode(enc[JSON_ENCODE_PARTS][0 .. enc[JSON_ENCODE_COUNT] - 1], "");
 }
 
 #endif /* __STD_JSON_H */
@@ -1,6 +1,7 @@
 /* Do not remove the headers from this file! see /USAGE for more info. */
 
 #include <commands.h>
+#include <move.h>
 
 object this_body();
 object find_body(string);
@@ -119,6 +120,90 @@ mixed deep_useful_inv(object ob)
    return ({});
 }
 
+//: FUNCTION batch_moves
+// Evaluates f with the bookkeeping of the given containers held, so that
+// objects moving in and out of them many at a time only pass the changes
+// in mass, light and contents up to their environments once.  See
+// hold_bookkeeping() in CONTAINER.
+mixed batch_moves(object *containers, function f)
+{
+   mixed ret;
+   string err;
+
+   containers = filter(containers - ({0}), ( : function_exists("hold_bookkeeping", $1) :));
+   containers->hold_bookkeeping();
+   err = catch (ret = evaluate(f));
+   containers->release_bookkeeping();
+   if (err)
+      error(err);
+   return ret;
+}
+
+private
+void move_each(object *obs, object dest, string relation, mapping results)
+{
+   foreach (object ob in obs)
+      if (ob)
+         results[ob] = ob->move(dest, relation);
+}
+
+//: FUNCTION move_many
+// Moves each of obs to dest, with the given relation or dest's default.
+// Each object moves with move() as it would on its own, with the same
+// hooks and checks, and the moves that fail don't stop the rest; the
+// bookkeeping of dest and the places the objects leave is done once at
+// the end, see batch_moves().  Returns ([ ob : result of its move() ]).
+varargs mapping move_many(object *obs, mixed dest, string relation)
+{
+   mapping results = ([]);
+   object *containers;
+
+   obs -= ({0});
+   if (stringp(dest))
+      dest = load_object(dest);
+   if (!objectp(dest))
+   {
+      foreach (object ob in obs)
+         results[ob] = MOVE_NO_DEST;
+      return results;
+   }
+
+   containers = ({dest}) + map(obs, ( : environment:));
+   containers = keys(mkmapping(containers, containers));
+   batch_moves(containers, ( : move_each, obs, dest, relation, results:));
+   return results;
+}
+
+//: FUNCTION present_named
+// Works like present(arg, env), but only asks the objects a container has
+// indexed under the name, rather than everything in it.  See query_named()
+// in CONTAINER.
+object present_named(string arg, object env)
+{
+   object *obs;
+   object *inv;
+   string word;
+   int which = 1;
+
+   if (!arg || !env)
+      return 0;
+   if (sscanf(arg, "%s %d", word, which) != 2)
+      word = arg;
+   if (which < 1 || strsrch(word, ' ') != -1 || !function_exists("query_named", env))
+      return present(arg, env);
+
+   obs = filter(env->query_named(word), ( : $1->id($(word)) :));
+   if (sizeof(obs) < which)
+      return 0;
+   if (sizeof(obs) == 1)
+      return obs[0];
+
+   /* present() goes by inventory order */
+   inv = all_inventory(env);
+   obs = sort_array(obs, ( : member_array($1, $(inv)) - member_array($2, $(inv)) :));
+   return obs[which - 1];
+}
+
 object get_object(string arg)
 {
    object ob;
@@ -135,8 +220,8 @@ object get_object(string arg)
    if (arg == "shell")
       return this_user()->query_shell_ob();
 
-   if (!(ob = present(arg, this_body())))
-      if (environment(this_body()) && !(ob = present(arg, environment(this_body()))))
+   if (!(ob = present_named(arg, this_body())))
+      if (environment(this_body()) && !(ob = present_named(arg, environment(this_body()))))
          if (!(ob = find_body(arg)))
             if (!(ob = load_object(evaluate_path(arg))))
                if (!(ob = load_object(evaluate_path(arg) + ".scr")))
@@ -205,60 +290,120 @@ int usable(object o, int flag)
    return immediately_accessible(o);
 }
 
-/* returns a nice listing of the given objects */
-/* if (flag) then don't print untouched obs */
-/* depth is for internal use only */
-varargs string inv_list(object *obs, int flag, int depth)
+//: FUNCTION group_key
+// Returns the key objects are grouped by in inventory listings; objects
+// with the same key are compare_objects() identical and are listed as
+// "3 swords".  Objects with an ob_state() of -1 are never grouped and
+// return 0.
+string group_key(object ob)
+{
+   mixed state = ob->ob_state();
+
+   if (state == -1)
+      return 0;
+   return sprintf("%s\n%O\n%O\n%O", base_name(ob), state, ob->get_attributes(), ob->setup_args());
+}
+
+//: FUNCTION group_objects
+// Sorts the objects into groups of identical objects in a single pass.
+// Returns an array of groups, each an array of objects, in the order the
+// first member of each group appears in obs.
+mixed *group_objects(object *obs)
+{
+   mapping index = ([]);
+   mixed *groups = ({});
+   string key;
+
+   foreach (object ob in obs)
+   {
+      if (!ob)
+         continue;
+      key = group_key(ob);
+      if (key && !undefinedp(index[key]))
+         groups[index[key]] += ({ob});
+      else
+      {
+         if (key)
+            index[key] = sizeof(groups);
+         groups += ({({ob})});
+      }
+   }
+   return groups;
+}
+
+//: FUNCTION inv_list_groups
+// Like inv_list(), but takes objects already sorted by group_objects().
+// Containers keep their contents sorted between listings, see
+// query_groups() in CONTAINER.
+varargs string inv_list_groups(mixed *groups, int flag, int depth)
 {
    string res;
-   int j;
+   object first;
+   int j, n;
 
    depth++;
    res = "";
-   foreach (object ob in obs - ({0}))
+   foreach (object *group in groups)
    {
-      if (!ob->is_visible())
-         continue;
-      if (!ob->short())
-         continue;
-      if (flag && !ob->test_flag(TOUCHED) && ob->untouched_long())
-         continue;
-      if (ob->is_attached())
+      first = 0;
+      n = 0;
+      foreach (object ob in group)
       {
-         if (ob->inventory_visible() && !ob->query_hide_contents())
-            res += ob->inventory_recurse(depth);
+         if (!ob)
+            continue;
+         if (!ob->is_visible())
+            continue;
+         if (!ob->short())
+            continue;
+         if (flag && !ob->test_flag(TOUCHED) && ob->untouched_long())
+            continue;
+         if (ob->is_attached())
+         {
+            if (ob->inventory_visible() && !ob->query_hide_contents())
+               res += ob->inventory_recurse(depth);
+            continue;
+         }
+         if (!n++)
+            first = ob;
+      }
+      if (!first)
          continue;
+
+      for (j = 0; j < depth; j++)
+         res += "  ";
+      if (n > 1)
+      {
+         if (n > 4)
+            res += "many " + first->plural_short();
+         else
+            res += n + " " + first->plural_short();
       }
-      if (!duplicatep(ob))
+      else
       {
-         for (j = 0; j < depth; j++)
-            res += "  ";
-         if ((j = count(ob)) > 1)
+         if (first->is_living())
          {
-            if (j > 4)
-               res += "many " + ob->plural_short();
-            else
-               res += j + " " + ob->plural_short();
+            res += first->in_room_desc();
          }
          else
          {
-            if (ob->is_living())
-            {
-               res += ob->in_room_desc();
-            }
-            else
-            {
-               res += ob->a_short() + ob->get_attributes();
-            }
+            res += first->a_short() + first->get_attributes();
          }
-         res += "\n";
-         if (ob->inventory_visible() && !ob->query_hide_contents())
-            res += ob->inventory_recurse(depth);
       }
+      res += "\n";
+      if (first->inventory_visible() && !first->query_hide_contents())
+         res += first->inventory_recurse(depth);
    }
    return res == "" ? 0 : res;
 }
 
+/* returns a nice listing of the given objects */
+/* if (flag) then don't print untouched obs */
+/* depth is for internal use only */
+varargs string inv_list(object *obs, int flag, int depth)
+{
+   return inv_list_groups(group_objects(obs), flag, depth);
+}
+
 object owner(object ob)
 {
    object env;
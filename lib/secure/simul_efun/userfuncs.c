@@ -18,40 +18,34 @@ nomask object this_body()
    return u ? u->query_body() : 0;
 }
 
+//: FUNCTION find_user
+// Find the user object logged in as the given userid.  Link-dead users
+// are only found if even_linkdead is set.  See the online index in USER_D.
 varargs nomask object find_user(string str, int even_linkdead)
 {
-   object *choices;
-
-   if (even_linkdead)
-      choices = children(USER_OB);
-   else
-      choices = users();
-   choices = filter(choices, ( : $1->query_userid() == $(str) :));
-
-   if (sizeof(choices))
-      return choices[0];
+   if (!str || str == "")
+      return 0;
 
-   return 0;
+   return USER_D->query_online_user(str, even_linkdead);
 }
 
+//: FUNCTION find_body
+// Find the body of the user logged in as the given userid, or else the
+// body going by that name or nickname.
 varargs nomask object find_body(string str, int even_linkdead)
 {
-   object u = find_user(str, even_linkdead);
-
    if (!str || str == "")
-   {
       return 0;
-   }
-   if (u && (u = u->query_body()))
-      return u;
 
-   foreach (object b in bodies())
-   {
-      if (b->query_nickname() == str)
-         return b;
-   }
+   return USER_D->query_online_body(str, even_linkdead);
+}
 
-   return 0;
+//: FUNCTION find_bodies_by_prefix
+// Find the bodies of connected users whose name or nickname starts with
+// the given prefix, for matching partial names.
+nomask object *find_bodies_by_prefix(string prefix)
+{
+   return USER_D->query_bodies_by_prefix(prefix);
 }
 
 nomask int wizardp(mixed m)
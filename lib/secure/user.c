@@ -57,6 +57,7 @@ void remove()
 {
    object body = query_body();
 
+   USER_D->unregister_user();
    MAILBOX_D->unload_mailbox(query_userid());
    unload_mailer();
 
@@ -102,6 +103,7 @@ nomask void net_dead()
    if (body)
    {
       body->net_dead();
+      USER_D->register_linkdead();
       call_out(( : remove:), 300);
    }
    else
@@ -12,6 +12,15 @@ int *query_window_size();
 
 int screen_width;
 
+/* Output collected between hold_output() and release_output() */
+private
+nosave string *held_output;
+private
+nosave int held_since;
+
+// Seconds held output waits at most; a round only takes one evaluation.
+#define HOLD_LIMIT 2
+
 void set_screen_width(int width)
 {
    screen_width = width;
@@ -130,6 +139,33 @@ void remove_colour(string which)
    save_me();
 }
 
+//: FUNCTION hold_output
+// Collect everything sent to us until release_output() is called, so that
+// a combat round reaches the socket as one write. If the release never
+// comes, the output goes out anyway with the first message after
+// HOLD_LIMIT seconds.
+void hold_output()
+{
+   if (base_name(previous_object()) != COMBAT_D)
+      return;
+   if (!held_output)
+   {
+      held_output = ({});
+      held_since = time();
+   }
+}
+
+//: FUNCTION release_output
+// Send whatever was collected since hold_output().
+void release_output()
+{
+   string *out = held_output;
+
+   held_output = 0;
+   if (out && sizeof(out))
+      receive(implode(out, ""));
+}
+
 void do_receive(string msg, int msg_type)
 {
    string *lines = explode(msg, "\n");
@@ -159,6 +195,8 @@ void do_receive(string msg, int msg_type)
    }
 
    msg = implode(lines, "\n");
+   if (!(msg_type & NO_ANSI))
+      msg = XTERM256_D->minimise_sgr(msg, terminal_mode());
 
    if (!(msg_type & MSG_PROMPT))
    {
@@ -169,7 +207,12 @@ void do_receive(string msg, int msg_type)
    if (query_shell_ob() && query_shell_ob()->get_variable("emoji") == 1)
       msg = EMOJI_D->emoji_replace(msg, msg_type);
 
-   receive(msg);
+   if (held_output && time() - held_since > HOLD_LIMIT)
+      release_output();
+   if (held_output)
+      held_output += ({msg});
+   else
+      receive(msg);
 }
 
 /*
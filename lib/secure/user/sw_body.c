@@ -88,6 +88,7 @@ varargs nomask void switch_body(string new_body_fname, int permanent)
    body = new (new_body_fname, query_selected_body());
    // TBUG(body);
    master()->refresh_parse_info();
+   USER_D->register_body();
 
    if (old_body)
    {
@@ -113,6 +114,7 @@ nomask void incarnate(string name, int is_new, string new_fname)
       body_fname = new_fname;
    body = new (body_fname, name);
    master()->refresh_parse_info();
+   USER_D->register_body();
 
    LAST_LOGIN_D->register_last(name, query_ip_name(this_object()));
    if (query_gender(name) != -1)
@@ -152,6 +154,7 @@ nomask void rcv_try_to_boot(object who, string answer)
          who->steal_body();
          start_shell();
          body->reconnect(this_object());
+         USER_D->register_body();
          return;
       }
       sw_body_handle_existing_logon(query_userid(),0);
@@ -218,6 +221,7 @@ nomask void sw_body_handle_existing_logon(string name, int enter_now)
                the_user->steal_body();
                start_shell();
                body->reconnect(this_object());
+               USER_D->register_body();
                return;
             }
          }
@@ -7,6 +7,7 @@ string *query_limbs();
 string query_random_limb();
 string *query_non_limbs();
 varargs int query_max_health(string);
+void invalidate_mitigation();
 
 class wear_info
 {
@@ -121,6 +122,7 @@ nomask int wear_item(object what, string where)
                   wi.others = ({what});
                wi.others -= ({0});
             }
+      invalidate_mitigation();
       return 1;
    }
 
@@ -141,6 +143,7 @@ nomask int wear_item(object what, string where)
             wi.others -= ({0});
          }
 
+   invalidate_mitigation();
    return 1;
 }
 
@@ -186,6 +189,7 @@ nomask int remove_item(object what, string where)
                   wi.others = 0;
             }
          }
+   invalidate_mitigation();
    return 1;
 }
 
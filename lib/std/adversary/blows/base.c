@@ -1,6 +1,7 @@
 /* Do not remove the headers from this file! see /USAGE for more info. */
 
 #include <combat_modules.h>
+#include <hooks.h>
 
 #define STUN_FROM_PERCENT 40
 
@@ -10,8 +11,23 @@ private
 nosave int natural_armor = 0;
 nosave string *resistances = ({});
 nosave string *vulnerabilities = ({});
+
+#if ARMOR_STYLE == ARMOR_LIMBS && BLOW_STYLE == BLOW_TYPES
+/*
+** The armour on each limb, worked out into what it does against each
+** damage type, so a hit is one lookup rather than a call to every piece.
+** limb -> ({ armors, ([ damage type : profile ]) }), where a profile is
+** ({ armors, fixed, halves }): each piece in turn changes the damage by
+** its fixed amount, less random(h) for its half armour class h, and the
+** damage can't go below 0 after any piece.  Thrown away by
+** invalidate_mitigation().
+*/
+private
+nosave mapping mitigation = ([]);
+#endif
 varargs int hurt_us(int, string);
 varargs void attacked_by(object, int);
+varargs mixed call_hooks(string, mixed, mixed, mixed *...);
 string query_random_limb();
 void handle_message(string, object, object, string);
 string damage_message(int);
@@ -130,8 +146,110 @@ class event_info health_modify_event(class event_info evt)
    return evt;
 }
 
+//: FUNCTION invalidate_mitigation
+// void invalidate_mitigation()
+// Called when armour is worn or removed, or its armour class, resistances
+// or weaknesses change, so the mitigation profiles are worked out again.
+void invalidate_mitigation()
+{
+#if ARMOR_STYLE == ARMOR_LIMBS && BLOW_STYLE == BLOW_TYPES
+   mitigation = ([]);
+#endif
+}
+
+#if ARMOR_STYLE == ARMOR_LIMBS && BLOW_STYLE == BLOW_TYPES
+private
+mixed *compile_mitigation(object *armors, mixed type)
+{
+   int *fixed = allocate(sizeof(armors));
+   int *halves = allocate(sizeof(armors));
+
+   for (int i = 0; i < sizeof(armors); i++)
+   {
+      int *m = armors[i]->query_mitigation(type);
+      int ac = armors[i]->query_armor_class();
+
+      fixed[i] = m[0];
+      if (m[2])
+         fixed[i] -= m[1] + ac;
+      else
+      {
+         fixed[i] -= ac / 2;
+         halves[i] = ac / 2;
+      }
+   }
+   return ({armors, fixed, halves});
+}
+
+private
+mixed *query_mitigation_profile(class event_info evt)
+{
+   string limb = evt.target_extra;
+   mixed type = evt.data[0];
+   mixed key = arrayp(type) ? implode(type, ",") : type;
+   mixed *entry = mitigation[limb];
+   mixed *profile;
+   object *armors;
+
+   /* Armour destructed while worn doesn't call remove_item() */
+   if (!entry || member_array(0, entry[0]) != -1)
+   {
+      armors = filter(event_get_armors(evt) || ({}), ( : function_exists("query_mitigation", $1) :));
+      entry = mitigation[limb] = ({armors, ([])});
+   }
+   if (!sizeof(entry[0]))
+      return 0;
+   if (!(profile = entry[1][key]))
+      profile = entry[1][key] = compile_mitigation(entry[0], type);
+   return profile;
+}
+#endif
+
 class event_info armors_modify_event(class event_info evt)
 {
+#if ARMOR_STYLE == ARMOR_LIMBS && BLOW_STYLE == BLOW_TYPES
+   mixed *profile;
+   object *armors;
+   int *changes;
+   int damage, worn;
+
+   if (stringp(evt.data) || !stringp(evt.target_extra))
+      return evt;
+   if (!(profile = query_mitigation_profile(evt)))
+      return evt;
+
+   armors = profile[0];
+   changes = allocate(sizeof(armors));
+   damage = evt.data[1];
+   for (int i = 0; i < sizeof(armors); i++)
+   {
+      int was = damage;
+
+      damage += profile[1][i];
+      if (profile[2][i] > 0)
+         damage -= random(profile[2][i]);
+      if (damage < 0)
+         damage = 0;
+      changes[i] = was - damage;
+   }
+   evt.data[1] = damage;
+
+   /* The durability pass: each piece wears by what it changed, and the
+    * weapon by all of it, as sink_modify_event() would */
+   if (evt.weapon)
+   {
+      for (int i = 0; i < sizeof(armors); i++)
+         if (changes[i])
+         {
+            if (armors[i])
+               armors[i]->decrease_durability(changes[i]);
+            worn += abs(changes[i]);
+         }
+      if (worn)
+         evt->weapon->decrease_durability(worn);
+   }
+   return evt;
+#else
    object *armors = event_get_armors(evt);
 
    // TBUG(armors);
@@ -140,6 +258,7 @@ class event_info armors_modify_event(class event_info evt)
          if (ob)
             evt = ob->sink_modify_event(evt);
    return evt;
+#endif
 }
 
 // This is the method that gets called in the target object. Before
@@ -158,6 +277,7 @@ int do_damage_event(class event_info evt)
    if (evt.data != "miss")
    {
       x = hurt_us(event_damage(evt), evt.target_extra);
+      call_hooks("damaged", HOOK_IGNORE, 0, previous_object(), x);
    }
    if (member_array(previous_object(), query_targets()) == -1)
       attacked_by(previous_object(), 0);
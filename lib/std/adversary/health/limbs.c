@@ -32,11 +32,15 @@ void set_max_health(int);
 int karma_impact();
 int should_cap_skill(string skillname);
 varargs int test_skill(string skill, int opposing_skill, int no_learn);
+void invalidate_mitigation();
 
 private
 nosave string body_style = "humanoid";
 private
 nosave mapping limb_sizes;
+/* The limb sets and weights for our limbs, see limb_tables() */
+private
+nosave mapping tables;
 private
 mapping health = BODY_D->get_body("humanoid");
 private
@@ -257,6 +261,8 @@ int update_body_style(string bstyle)
       return 0;
 
    health = new_body;
+   tables = 0;
+   invalidate_mitigation();
 
    foreach (string name, class limb l in health)
    {
@@ -268,6 +274,25 @@ int update_body_style(string bstyle)
    return 1;
 }
 
+/*
+** The limb sets and weights of BODY_D->compile_limb_tables().  Adversaries
+** with the limbs of their body style share BODY_D's tables; anyone whose
+** limbs are different, say from an old save file, gets their own.
+*/
+private
+mapping limb_tables()
+{
+   mapping shared;
+
+   /* A restored save file can swap our limbs behind our back */
+   if (tables && sizeof(tables["limbs"]) == sizeof(health))
+      return tables;
+   shared = BODY_D->query_limb_tables(body_style);
+   if (shared && sizeof(shared["limbs"]) == sizeof(health) && !sizeof(shared["limbs"] - keys(health)))
+      return tables = shared;
+   return tables = BODY_D->compile_limb_tables(health);
+}
+
 string query_body_style()
 {
    return body_style;
@@ -303,7 +328,7 @@ int is_attacking_limb(string limb)
 // Returns a string *containing all limbs that health is applied to.
 string *query_limbs()
 {
-   return keys(health);
+   return limb_tables()["limbs"];
 }
 
 //: FUNCTION query_wielding_limbs
@@ -311,7 +336,7 @@ string *query_limbs()
 // Returns a string *containing all the limbs that can wield weapons.
 string *query_wielding_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->flags & LIMB_WIELDING:));
+   return limb_tables()["wielding"];
 }
 
 //: FUNCTION query_attacking_limbs
@@ -319,7 +344,7 @@ string *query_wielding_limbs()
 // Returns a string *containing all the limba that can attack.
 string *query_attacking_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->flags & LIMB_ATTACKING:));
+   return limb_tables()["attacking"];
 }
 
 //: FUNCTION query_vital_limbs
@@ -329,7 +354,7 @@ string *query_attacking_limbs()
 // adversary dies.
 string *query_vital_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->flags & LIMB_VITAL:));
+   return limb_tables()["vital"];
 }
 
 //: FUNCTION query_mobile_limbs
@@ -338,7 +363,7 @@ string *query_vital_limbs()
 // those who want health of mobile limbs to affect movement and such.
 string *query_mobile_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->flags & LIMB_MOBILE:));
+   return limb_tables()["mobile"];
 }
 
 //: FUNCTION query_system_limbs
@@ -347,7 +372,7 @@ string *query_mobile_limbs()
 // disabled, the adversary dies.
 string *query_system_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->flags & LIMB_SYSTEM:));
+   return limb_tables()["system"];
 }
 
 //: FUNCTION query_non_limbs
@@ -356,7 +381,7 @@ string *query_system_limbs()
 // Such body parts are defined by having a max_health of -1.
 string *query_non_limbs()
 {
-   return filter(keys(health), ( : ((class limb)health[$1])->max_health == -1 :));
+   return limb_tables()["non_limbs"];
 }
 
 //: FUNCTION query_reflex
@@ -564,14 +589,46 @@ string query_random_limb()
 // have hitpoints are returned.
 string query_random_limb()
 {
-   mapping limbs;
+   mixed *weighted;
+   string *limbs;
+   int *weights;
+   int n, total;
+   mapping alive;
+
    if (!limb_sizes)
    {
       update_body_style(body_style);
    }
-   limbs = filter_mapping(limb_sizes, ( : ((class limb)health[$1])->health > 0 :));
+   weighted = limb_tables()["weighted"];
+   limbs = weighted[0];
+   weights = weighted[1];
+   if (!(n = sizeof(limbs)))
+      return 0;
+   total = weights[n - 1];
 
-   return sizeof(limbs) ? element_of_weighted(limbs) : 0;
+   /* Pick by size, and pick again if the limb is disabled; that is the
+    * same as picking among the working limbs.  Give up on that after a
+    * few tries, when most of them are disabled. */
+   for (int tries = 0; tries < 4; tries++)
+   {
+      int r = random(total);
+      int lo = 0, hi = n - 1;
+
+      while (lo < hi)
+      {
+         int mid = (lo + hi) / 2;
+
+         if (weights[mid] > r)
+            hi = mid;
+         else
+            lo = mid + 1;
+      }
+      if (((class limb)health[limbs[lo]])->health > 0)
+         return limbs[lo];
+   }
+
+   alive = filter_mapping(limb_sizes, ( : ((class limb)health[$1])->health > 0 :));
+   return sizeof(alive) ? element_of_weighted(alive) : 0;
 }
 
 //: FUNCTION disable_limb
@@ -724,9 +781,9 @@ varargs int query_max_health(string limb)
    if (limb)
       return is_limb(limb) ? ((class limb)health[limb])->max_health : 0;
 
-   foreach (string l in keys(health))
-      if (health[l].max_health > x)
-         x = health[l].max_health;
+   foreach (string l, class limb lb in health)
+      if (lb.max_health > x)
+         x = lb.max_health;
    return x;
 }
 
@@ -737,7 +794,7 @@ varargs void heal_us(int x, string limb)
 {
    if (!limb || undefinedp(limb))
    {
-      foreach (limb in keys(health))
+      foreach (limb in query_limbs())
          heal_limb(limb, x);
       return;
    }
@@ -750,8 +807,8 @@ varargs void heal_us(int x, string limb)
 // Heal us entirely.
 void heal_all()
 {
-   foreach (string l in keys(health))
-      if (!health[l].health)
+   foreach (string l, class limb lb in health)
+      if (!lb.health)
          enable_limb(l);
    heal_us(query_max_health());
    set_drunk(0);
@@ -787,8 +844,10 @@ void update_health()
 
    if (time() != health_time)
    {
-      foreach (string limb in keys(health))
-         heal_limb(limb, fuzzy_divide((time() - health_time) * heal_rate, 3000));
+      int amount = fuzzy_divide((time() - health_time) * heal_rate, 3000);
+
+      foreach (string limb in query_limbs())
+         heal_limb(limb, amount);
       restore_reflex(fuzzy_divide((time() - health_time) * (reflex_rate + this_object()->query_int()), 2000));
       health_time = time();
    }
@@ -835,10 +894,10 @@ varargs mixed *query_worst_limb(int vital)
    int hp_percent, min = 100;
    string l = "none";
 
-   foreach (string limb in keys(health))
+   foreach (string limb in vital ? query_vital_limbs() : query_limbs())
    {
       class limb lb = health[limb];
-      if (vital && !(lb.flags & LIMB_VITAL) || !lb.max_health)
+      if (!lb.max_health)
          continue;
 
       hp_percent = (100 * lb.health) / lb.max_health;
@@ -866,11 +925,11 @@ string badly_wounded()
       }
    }
 
-   foreach (string limb in keys(health))
+   foreach (string limb in query_vital_limbs())
    {
       class limb lb = health[limb];
 
-      if ((lb.flags & LIMB_VITAL) && (lb->health < ((lb.max_health * wimpy_at) / 100)))
+      if (lb->health < ((lb.max_health * wimpy_at) / 100))
       {
          banner_wounded(limb, lb.health);
          return limb;
@@ -883,11 +942,11 @@ string badly_wounded()
 // eating when they hit this level of damage.
 string very_wounded()
 {
-   foreach (string limb in keys(health))
+   foreach (string limb in query_vital_limbs())
    {
       class limb lb = health[limb];
 
-      if ((lb.flags & LIMB_VITAL) && (lb->health < ((lb.max_health * 50) / 100)))
+      if (lb->health < ((lb.max_health * 50) / 100))
       {
          banner_wounded(limb, lb.health);
          return limb;
@@ -4,9 +4,69 @@
 
 void simple_action(string msg, mixed *obs...);
 varargs mixed *action(mixed *, mixed, object, object);
+varargs string compose_message(object, string, object *, mixed *...);
 void inform(mixed *, mixed, object);
 string query_combat_message(string);
 
+/* The digest of the round COMBAT_D is running, see set_round_digest() */
+private
+nosave mapping round_digest;
+/* How much of other people's fights we see, see set_combat_digest() */
+private
+int combat_digest;
+
+//: FUNCTION set_combat_digest
+// Sets how much of other people's fights we see in a round run by COMBAT_D:
+// CD_FULL for every line, CD_PAIRS for a line per attacker and target at
+// the end of the round, or CD_ROOM for a single line. Our own blows, and
+// the blows aimed at us, are always shown in full.
+void set_combat_digest(int level)
+{
+   if (level < CD_FULL || level > CD_ROOM)
+      error("Bad combat digest level " + level + ".\n");
+   combat_digest = level;
+}
+
+int query_combat_digest()
+{
+   return combat_digest;
+}
+
+//: FUNCTION set_round_digest
+// Called around our turn in a round. digest is shared by everyone fighting
+// in the room that round, see COMBAT_D, or 0 if nobody there wants one.
+void set_round_digest(mapping digest)
+{
+   round_digest = digest;
+}
+
+private
+void digest_blow(object target, string what)
+{
+   mapping pairs = round_digest["pairs"];
+   mixed *entry;
+   int level;
+
+   if (!pairs[this_object()])
+      pairs[this_object()] = ([]);
+   if (!(entry = pairs[this_object()][target]))
+   {
+      entry = pairs[this_object()][target] = ({0, 0, 0, ({})});
+      round_digest["order"] += ({({this_object(), target})});
+   }
+
+   if (what == "miss" || what == "none")
+      entry[CD_MISSES]++;
+   else if (sscanf(what, "dam%d", level) == 1)
+   {
+      entry[CD_HITS]++;
+      if (level > entry[CD_WORST])
+         entry[CD_WORST] = level;
+   }
+   else
+      entry[CD_FEATS] += ({what});
+}
+
 string damage_message(int percent)
 {
    switch (percent)
@@ -70,11 +130,14 @@ int message_filter(object who, mixed extra)
 void handle_message(string mess, object target, object weapon, string limb)
 {
    mixed *combat_who, messages;
+   string key;
 
    if (mess[0] == '!')
    {
       string tmp;
 
+      key = mess[1..];
+
       if (weapon)
          tmp = weapon->query_combat_message(mess[1..]);
       else
@@ -101,6 +164,26 @@ void handle_message(string mess, object target, object weapon, string limb)
    }
    if (!limb)
       limb = target->query_random_limb();
+
+   if (round_digest && key)
+   {
+      object *skip = combat_who + round_digest["watchers"];
+      mixed *obs = ({weapon->alt_weapon() ? weapon->alt_weapon() : weapon, target->query_weapon(), limb,
+                     weapon->secondary_weapon_part()});
+
+      digest_blow(target, key);
+      if (arrayp(mess))
+         mess = choice(mess);
+
+      /* the bystanders' line is only made if someone reads it in full */
+      messages = ({compose_message(this_object(), mess, combat_who, obs...),
+                   compose_message(target, mess, combat_who, obs...)});
+      inform(combat_who, messages, 0);
+      if (round_digest["full"])
+         tell_from_inside(environment(), compose_message(0, mess, combat_who, obs...), MSG_INDENT, skip);
+      return;
+   }
+
    messages = action(combat_who, mess, weapon->alt_weapon() ? weapon->alt_weapon() : weapon, target->query_weapon(),
                      limb, weapon->secondary_weapon_part());
 
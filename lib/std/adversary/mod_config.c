@@ -39,7 +39,7 @@ void check_combat_config()
    error("No valid armor style set.\n");
 #endif
 
-#if PULSE_STYLE != PULSE_NON_HEART_BEAT && PULSE_STYLE != PULSE_HEART_BEAT
+#if PULSE_STYLE != PULSE_NON_HEART_BEAT && PULSE_STYLE != PULSE_HEART_BEAT && PULSE_STYLE != PULSE_ROUND
    error("No valid pulse style set.\n");
 #endif
 
@@ -0,0 +1,96 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+// Room round based interface to combat.  It is intended that this will
+// be interchangeable with the heart_beat based module.
+//
+// Instead of a heart_beat per combatant, COMBAT_D runs one round per room
+// each heart_beat, taking everybody fighting there in initiative order.
+
+void switch_to(object);
+void attack();
+object get_target();
+void set_round_occupants(mapping);
+void set_round_digest(mapping);
+int query_agi();
+
+nosave int attacking = 0;
+
+void set_attack_speed(int x)
+{
+}
+
+int query_penalty()
+{
+   return 0;
+}
+
+//: FUNCTION query_initiative
+// Where we come in the round order; higher goes first.
+int query_initiative()
+{
+   return query_agi();
+}
+
+void do_something()
+{
+   if (!attacking)
+   {
+      COMBAT_D->leave_combat();
+      return;
+   }
+
+   attack();
+}
+
+//: FUNCTION combat_round
+// Called by COMBAT_D once per round. occupants is the round's shared
+// snapshot of who is in the room, used for target validation, and digest
+// collects the round for observers who want it summed up, or is 0.
+varargs void combat_round(mapping occupants, mapping digest)
+{
+   if (base_name(previous_object()) != COMBAT_D)
+      return;
+
+   set_round_occupants(occupants);
+   set_round_digest(digest);
+   catch (do_something());
+   set_round_occupants(0);
+   set_round_digest(0);
+}
+
+/* Call this function to make us start a fight with "who".  It's
+ * ok if we're already fighting them.  If they aren't the current
+ * attacker, then they will be.
+ */
+varargs void attacked_by(object who, int take_a_swing)
+{
+   switch_to(who);
+
+   if (!attacking)
+   {
+      attacking = 1;
+      COMBAT_D->join_combat();
+      if (take_a_swing)
+         do_something();
+   }
+}
+
+string continue_fight()
+{
+   if (!get_target())
+      return "You aren't attacking anyone.\n";
+   // wait for the next round
+   return "All in good time.\n";
+}
+
+void stop_attacking()
+{
+   if (attacking)
+      COMBAT_D->leave_combat();
+   attacking = 0;
+}
+
+int is_attacking()
+{
+   return attacking;
+}
@@ -14,6 +14,8 @@ private
 nosave object target;
 private
 nosave object *other_targets = ({});
+private
+nosave mapping round_occupants;
 #ifdef TARGETTING_IS_RANDOM
 private
 nosave int explicit; // Attack the person we just switch_to()'ed
@@ -29,6 +31,24 @@ object *query_targets()
    return ({target}) + other_targets;
 }
 
+//: FUNCTION set_round_occupants
+// Set by the combat round scheduler: a snapshot of the room's useful
+// inventory shared by every combatant in the round, or 0 outside a round.
+void set_round_occupants(mapping occupants)
+{
+   round_occupants = occupants;
+}
+
+private
+int target_here(object who)
+{
+   object here = parser_root_environment(environment(this_object()));
+
+   if (round_occupants)
+      return round_occupants[who] && parser_root_environment(environment(who)) == here;
+   return member_array(who, deep_useful_inv(here)) != -1;
+}
+
 /* Find someone to attack.  Return zero if we're dead or asleep or
  * have no one to attack.
  */
@@ -55,8 +75,7 @@ object get_target()
 #endif
    // Make sure they are alive and in the same room as us.  If not, find
    // someone else.
-   while (!target || target->query_ghost() ||
-          (member_array(target, deep_useful_inv(parser_root_environment(environment(this_object())))) == -1))
+   while (!target || target->query_ghost() || !target_here(target))
    {
       if (!n)
          return (target = 0);
@@ -16,6 +16,7 @@
 //      Wizards can see DARK_EXITS as they are denoted with a *name format.
 // 951113, Deathblade: removed some obsolete vars; made them all private
 
+#include <clean_up.h>
 #include <hooks.h>
 #include <move.h>
 #include <setbit.h>
@@ -41,6 +42,10 @@ private
 nosave int tag;
 private
 nosave int no_combat;
+private
+nosave int keep_loaded;
+private
+nosave int reset_owed;
 
 //: FUNCTION stat_me
 // Returns some debugging info about the object.  Shows the container info,
@@ -104,6 +109,12 @@ void create(mixed *args...)
       this_object()->internal_setup();
 
       setup(args...);
+
+      // Keep the room graph up to date when rooms are (re)compiled.
+      catch (ROOM_GRAPH_D->index_room(this_object()));
+
+      // Put back what was here if we were evicted while idle.
+      catch (ROOM_LIFECYCLE_D->room_loaded());
    }
 }
 
@@ -215,13 +226,82 @@ string long()
 {
 #ifdef OBVIOUS_EXITS_BOTTOM
    string objtally = show_objects();
-   return sprintf("%sObvious Exits: %%^ROOM_EXIT%%^%s%%^RESET%%^\n%s", (dont_show_long() ? "" : fancy_long()),
-                  show_exits() + "\n", objtally);
+   return sprintf("%sObvious Exits: %%^ROOM_EXIT%%^%s%%^RESET%%^\n%s", (dont_show_long() ? "" : rendered_long()),
+                  rendered_exits() + "\n", objtally);
 #else
-   return sprintf("%s%s", (dont_show_long() ? "" : rtrim(fancy_long()) + "\n"), show_objects());
+   return sprintf("%s%s", (dont_show_long() ? "" : rtrim(rendered_long()) + "\n"), show_objects());
 #endif
 }
 
+/* Anything that changes what is listed in the room also changes how the
+ * room looks. */
+void invalidate_groups()
+{
+   ::invalidate_groups();
+   bump_render_generation();
+   ROOM_LIFECYCLE_D->touch();
+}
+
+//: FUNCTION reset
+// Resets are spread out by RESET_D rather than all run when the driver
+// asks.  A room with no players in it owes the reset until a player walks
+// in; further resets until then are folded into that one.
+void reset()
+{
+   if (!sizeof(filter(all_inventory(), ( : $1->query_link() :))))
+   {
+      RESET_D->reset_deferred(reset_owed);
+      reset_owed = 1;
+      return;
+   }
+   RESET_D->schedule_reset();
+}
+
+//: FUNCTION run_reset
+// Does the work of a reset; called by RESET_D.
+void run_reset()
+{
+   reset_owed = 0;
+   container::reset();
+}
+
+mixed receive_object(object target, string relation)
+{
+   mixed ret = container::receive_object(target, relation);
+
+   if (ret == 1 && reset_owed && target->query_link())
+      RESET_D->reset_on_entry();
+   return ret;
+}
+
+//: FUNCTION set_keep_loaded
+// set_keep_loaded(1) stops ROOM_LIFECYCLE_D from unloading the room when
+// it is idle.
+void set_keep_loaded(int x)
+{
+   keep_loaded = x;
+}
+
+int query_keep_loaded()
+{
+   return keep_loaded;
+}
+
+//: FUNCTION clean_up
+// Idle domain rooms are unloaded by ROOM_LIFECYCLE_D, which keeps a
+// snapshot of what was left in them; rooms in use are asked again later.
+int clean_up()
+{
+   if (!clonep() && strsrch(file_name(), "/domains/") == 0)
+      return ROOM_LIFECYCLE_D->evict(this_object()) ? NEVER_AGAIN : ASK_AGAIN;
+   return ::clean_up();
+}
+
+void description_changed()
+{
+   bump_render_generation();
+}
+
 //: FUNCTION long_without_object
 // This is used by things like furniture, so the furniture can use the
 // same long as the room, but not see itself in the description.
@@ -23,9 +23,13 @@ int *q = ({});
  */
 string emotion_string();
 string discover_parent(string node);
-void debug(mixed s);
+void record_trace(mixed s);
 int debugging();
 int query_observers();
+int should_sleep();
+void fall_asleep();
+int tree_compiled();
+void compile_tree();
 int parses = 0;
 
 string get_extra_long()
@@ -33,77 +37,96 @@ string get_extra_long()
    return this_object()->short() + " radiates " + emotion_string() + ".\n";
 }
 
-varargs int evaluate_node()
+// Returned by visit_node() when the next node should run straight away,
+// and when the tree has gone to sleep.
+#define VISIT_NEXT 0
+#define VISIT_STOP -1
+
+// A tree that loops this many nodes without reaching a leaf is broken;
+// give up on the step rather than spin.
+#define MAX_STEP_VISITS 1000
+
+// Process the node at the front of the queue. Returns the pause the node
+// asks for, VISIT_NEXT or VISIT_STOP.
+private
+int visit_node()
 {
    class node node, parent;
+
+   if (!tree_compiled())
+      compile_tree();
    node = front();
-   parent = parent(node);
 
    if (!node)
    {
-      debug("<161>Queue empty - missing node? Restarting from <069>ROOT<res>.");
-      frontpush("root");
-      return;
+      BT_TRACE("<161>Queue empty - missing node? Restarting from <069>ROOT<res>.");
+      frontpush(0);
+      return VISIT_NEXT;
    }
+   parent = parent(node);
 
-   debug("<214>Evaluating node: <043>" + node.name + "<res> <214>Queue: <043>" + print_queue() + "<res>");
+   BT_TRACE("<214>Evaluating node: <043>" + node.name + "<res> <214>Queue: <043>" + print_queue() + "<res>");
    switch (node.type)
    {
    case NODE_ROOT:
-      debug(blackboard);
-      debug("<069>ROOT<res> node.");
+      BT_TRACE(blackboard);
+      BT_TRACE("<069>ROOT<res> node.");
       reset_tree(); // Reset tree when we see the root node.
-      backpush(node.children[0]);
+      backpush(node.child_ids[0]);
       parses++;
-      if (query_observers())
-         evaluate_node();
-      return;
-      break;
+      // Nobody has been around for a while, so stop here until woken.
+      if (should_sleep())
+      {
+         fall_asleep();
+         return VISIT_STOP;
+      }
+      return VISIT_NEXT;
    case NODE_SEQUENCE:
       // We're done in the sequence
-      debug("<154>SEQUENCE, node: <043>" + node.name + "<res> child: " + node.node_num +
-            " status: " + status(node.status) + "<res>");
+      BT_TRACE("<154>SEQUENCE, node: <043>" + node.name + "<res> child: " + node.node_num +
+               " status: " + status(node.status) + "<res>");
 
       // Did child fail or are we done? Then stop.
-      if (node.status == EVAL_FAILURE || (node.node_num >= sizeof(node.children) && parent))
+      if (node.status == EVAL_FAILURE || (node.node_num >= sizeof(node.child_ids) && parent))
       {
          parent.status = node.status;
-         frontpush(parent.name);
+         frontpush(parent.id);
       }
       else
       { // Run sequence
-         debug("<154>SEQUENCE CONTINUE node: <043>" + node.name + " status: " + status(node.status) + "<res>");
-         frontpush(node.children[node.node_num]);
+         BT_TRACE("<154>SEQUENCE CONTINUE node: <043>" + node.name + " status: " + status(node.status) + "<res>");
+         frontpush(node.child_ids[node.node_num]);
          node.status = EVAL_RUNNING;
          node.node_num++;
       }
       break;
    case NODE_LEAF:
-      debug("<154>LEAF <043>" + node.name + "<res>");
+      BT_TRACE("<154>LEAF <043>" + node.name + "<res>");
       parent.status = call_other(this_object(), node.name);
       pop();
       break;
    case NODE_SELECTOR:
-      debug("<154>SELECTOR <043>" + node.name + "<154> child: " + node.node_num + " Status: " + status(node.status) +
-            "<res>");
+      BT_TRACE("<154>SELECTOR <043>" + node.name + "<154> child: " + node.node_num +
+               " Status: " + status(node.status) + "<res>");
       // Did child fail or are we done? Then stop.
-      if (node.node_num >= sizeof(node.children) && parent)
+      if (node.node_num >= sizeof(node.child_ids) && parent)
       {
          parent.status = node.status;
-         frontpush(parent.name);
+         frontpush(parent.id);
       }
       else
       { // Run sequence
          if (node.status == EVAL_SUCCESS)
          {
-            debug("<154>SELECTOR STOPPED node: <043>" + node.name + " status: " + status(node.status) + "<res> ");
+            BT_TRACE("<154>SELECTOR STOPPED node: <043>" + node.name + " status: " + status(node.status) + "<res> ");
             parent.status = node.status;
-            frontpush(parent.name);
+            frontpush(parent.id);
          }
          else
          {
-            debug("<154>SELECTOR CONTINUES node: <043>" + node.name + " status: " + status(node.status) + "<res> ");
-            frontpush(node.children[node.node_num]);
+            BT_TRACE("<154>SELECTOR CONTINUES node: <043>" + node.name + " status: " + status(node.status) +
+                     "<res> ");
+            frontpush(node.child_ids[node.node_num]);
             node.status = EVAL_RUNNING;
             node.node_num++;
          }
@@ -115,12 +138,12 @@ varargs int evaluate_node()
       {
          // Flip 1 to 0, and 0 to 1.
          parent.status = !node.status;
-         frontpush(parent.name);
+         frontpush(parent.id);
       }
       else
       { // Run sequence
-         debug("<154>INVERTER: <043>" + node.name + "<res>");
-         frontpush(node.children[0]);
+         BT_TRACE("<154>INVERTER: <043>" + node.name + "<res>");
+         frontpush(node.child_ids[0]);
          node.status = EVAL_RUNNING;
          node.node_num++;
       }
@@ -132,34 +155,63 @@ varargs int evaluate_node()
          // Always a success!
          node.status = EVAL_SUCCESS;
          parent.status = EVAL_SUCCESS;
-         frontpush(parent.name);
+         frontpush(parent.id);
       }
       else
       { // Run sequence
-         debug("<154>SUCCEEDER: <043>" + node.name + "<res>");
-         frontpush(node.children[0]);
+         BT_TRACE("<154>SUCCEEDER: <043>" + node.name + "<res>");
+         frontpush(node.child_ids[0]);
          node.status = EVAL_RUNNING;
       }
       break;
 
    case NODE_REPEAT_UNTIL_FAIL:
-      debug("<154>REPEAT_UNTIL_FAIL: <043>" + node.name + "<res>");
+      BT_TRACE("<154>REPEAT_UNTIL_FAIL: <043>" + node.name + "<res>");
       // ## TODO Not implemented yet.
       break;
 
    default:
-      debug("<161>Don't know what to do with the <043>" + node.name + "<161> node<res>");
+      BT_TRACE("<161>Don't know what to do with the <043>" + node.name + "<161> node<res>");
       break;
    }
 
-   if (node.delay > 0)
+   return node.delay > 0 ? node.delay : VISIT_NEXT;
+}
+
+//: FUNCTION step_tree
+// Run the tree until a node asks for a pause, without scheduling anything.
+// Returns the pause in seconds, or 0 if the tree went dormant.
+int step_tree()
+{
+   int next;
+
+   for (int visits = 0; visits < MAX_STEP_VISITS; visits++)
+   {
+      next = visit_node();
+      if (next == VISIT_STOP)
+         return 0;
+      if (next != VISIT_NEXT)
+         return next;
+   }
+   BT_TRACE("<161>No leaf reached in " + MAX_STEP_VISITS + " nodes, pausing.<res>");
+   return LEAF_NODE_PAUSE;
+}
+
+varargs int evaluate_node()
+{
+   int delay = step_tree();
+
+   if (delay > 0)
    {
-      debug("<077>Queue delay: " + node.delay + " seconds.<res>");
+      if (should_sleep())
+      {
+         fall_asleep();
+         return;
+      }
+      BT_TRACE("<077>Queue delay: " + delay + " seconds.<res>");
       if (find_call_out("evaluate_node") == -1)
-         call_out("evaluate_node", debugging() ? CLAMP(node.delay, 3, 20) : node.delay);
+         call_out("evaluate_node", debugging() ? CLAMP(delay, 3, 20) : delay);
    }
-   else
-      evaluate_node(parent);
 }
 
 int parses_made()
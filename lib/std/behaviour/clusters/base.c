@@ -36,6 +36,11 @@ mapping emotions = ([0:0, 1:0, 2:0, 3:0, 4:0, 5:0, 6:0, 7:0]);
 mapping blackboard = ([]);
 mapping node_list, parents;
 
+// node_list compiled into a table indexed by node id, see compile_tree().
+class node *node_table;
+// Checked by BT_TRACE() before any trace string is built.
+int tracing;
+
 private
 function arrival_fn = ( : action_arrival:);
 private
@@ -52,7 +57,15 @@ int delay_time = 5; // Default delay time for leaves.
 private
 object debugee = 0; // The body of the person debugging us.
 private
-string *queue = ({}); // Queue of nodes that must be processed.
+int *queue = ({}); // Queue of node ids that must be processed.
+private
+int tree_compiled;
+private
+int trace_recording;
+private
+string *trace_ring;
+private
+int trace_next;
 
 private
 object *arrived = ({});
@@ -64,6 +77,17 @@ int behaviour_call_out;
 private
 int room_has_changed = 1;
 
+private
+int dormant;
+private
+int last_observed;
+private
+int dormant_since;
+private
+int dormancy_delay = DORMANCY_DELAY;
+private
+int dormancy_catch_up;
+
 int has_room_changed()
 {
    return room_has_changed;
@@ -104,24 +128,19 @@ string status(int s)
    }
 }
 
-void backpush(mixed node)
+void backpush(int id)
 {
-   if (arrayp(node))
-      queue += node;
-   else
-      queue += ({node});
+   queue += ({id});
 }
 
-void frontpush(string node)
+void frontpush(int id)
 {
-   queue = ({node}) + queue;
+   queue = ({id}) + queue;
 }
 
 string print_queue()
 {
-   string out = "";
-   int i = 1;
-   return format_list(queue);
+   return format_list(map(queue, ( : node_table[$1].name :)));
 }
 
 mapping query_nodes()
@@ -137,7 +156,7 @@ mapping query_parents()
 // Reset the tree states as well as the queue.
 void reset_tree()
 {
-   foreach (string name, class node node in node_list)
+   foreach (class node node in node_table)
    {
       node.status = EVAL_NONE;
       node.node_num = 0;
@@ -145,14 +164,52 @@ void reset_tree()
    queue = ({});
 }
 
+//: FUNCTION compile_tree
+// Number the nodes in node_list and resolve every parent and child name to
+// an index into node_table, so evaluation never looks a node up by name.
+// The root is always node 0. Done automatically after the tree changes.
+void compile_tree()
+{
+   string *names = ({"root"}) + (keys(node_list) - ({"root"}));
+   mapping ids = ([]);
+
+   if (!node_list["root"])
+      error("Behaviour tree has no root node.\n");
+   node_table = allocate(sizeof(names));
+   for (int i = 0; i < sizeof(names); i++)
+   {
+      ids[names[i]] = i;
+      node_table[i] = node_list[names[i]];
+   }
+   foreach (class node node in node_table)
+   {
+      node.id = ids[node.name];
+      node.parent_id = parents[node.name] && !undefinedp(ids[parents[node.name]]) ? ids[parents[node.name]] : -1;
+      node.child_ids = allocate(sizeof(node.children));
+      for (int i = 0; i < sizeof(node.children); i++)
+      {
+         if (undefinedp(ids[node.children[i]]))
+            error("Behaviour tree node '" + node.name + "' has unknown child '" + node.children[i] + "'.\n");
+         node.child_ids[i] = ids[node.children[i]];
+      }
+   }
+   queue = ({});
+   tree_compiled = 1;
+}
+
+int tree_compiled()
+{
+   return tree_compiled;
+}
+
 class node front()
 {
-   return sizeof(queue) ? node_list[queue[0]] : 0;
+   return sizeof(queue) ? node_table[queue[0]] : 0;
 }
 
 class node parent(class node node)
 {
-   return node && parents[node.name] ? node_list[parents[node.name]] : 0;
+   return node && node.parent_id != -1 ? node_table[node.parent_id] : 0;
 }
 
 class node pop()
@@ -189,6 +246,7 @@ varargs void create_node(int type, string name, mixed offspring)
                             delay
                           : type == NODE_LEAF ? LEAF_NODE_PAUSE : 0);
    parents[name] = discover_parent(name);
+   tree_compiled = 0;
 }
 
 void do_game_command(string str)
@@ -228,9 +286,101 @@ int query_observers()
    return 0;
 }
 
+//: FUNCTION set_dormancy_delay
+// Set how many seconds the NPC keeps thinking after the last player has
+// left its room. After that the tree goes dormant until something wakes
+// it. 0 keeps the tree running all the time.
+void set_dormancy_delay(int secs)
+{
+   dormancy_delay = secs;
+}
+
+int query_dormancy_delay()
+{
+   return dormancy_delay;
+}
+
+//: FUNCTION set_dormancy_catch_up
+// If set, the NPC calls catch_up() when it wakes from dormancy.
+void set_dormancy_catch_up(int flag)
+{
+   dormancy_catch_up = flag;
+}
+
+int query_dormant()
+{
+   return dormant;
+}
+
+// Returns 1 if nobody has watched us for long enough that the tree should
+// stop evaluating. Called by evaluate_node() before each step is queued.
+int should_sleep()
+{
+   if (!dormancy_delay || query_observers())
+   {
+      last_observed = time();
+      return 0;
+   }
+   return time() - last_observed >= dormancy_delay;
+}
+
+void stop_behaviour_call();
+
+// Drop every call_out we have. Something else has to wake_behaviour() us.
+void fall_asleep()
+{
+   if (dormant)
+      return;
+   dormant = 1;
+   dormant_since = time();
+   remove_call_out("evaluate_node");
+   stop_behaviour_call();
+   BEHAVIOUR_D->set_tree_dormant(1);
+}
+
+//: FUNCTION catch_up
+// Called with the number of seconds slept when a dormant tree wakes, if
+// set_dormancy_catch_up() is on. The default lets emotions settle a step
+// for every dormancy period slept, up to MAX_CATCH_UP_STEPS. Override it
+// for NPCs that should have done something while nobody was looking.
+void catch_up(int slept)
+{
+   int steps = dormancy_delay ? slept / dormancy_delay : 0;
+
+   for (int i = 0; i < steps && i < MAX_CATCH_UP_STEPS; i++)
+      calm_emotions();
+}
+
+//: FUNCTION wake_behaviour
+// Wake a dormant tree. Called on player arrival and damage, but anything
+// may call it.
+void wake_behaviour()
+{
+   last_observed = time();
+   if (!dormant)
+      return;
+   dormant = 0;
+   BEHAVIOUR_D->set_tree_dormant(0);
+   if (dormancy_catch_up)
+   {
+      catch_up(time() - dormant_since);
+      reset_tree();
+      frontpush(0);
+   }
+   if (find_call_out("evaluate_node") == -1)
+      call_out("evaluate_node", 1);
+}
+
+void behaviour_damaged(object attacker, int damage)
+{
+   wake_behaviour();
+}
+
 // The periodic action call_out
 void behaviour_call()
 {
+   if (dormant)
+      return;
    if (query_observers() && behaviour_call_out == 0)
       behaviour_call_out = call_out("behaviour_call", delay_time);
    evaluate_node();
@@ -279,6 +429,7 @@ void action_arrival(object who)
    something_arrived(who);
    if (who->query_link())
    {
+      wake_behaviour();
       if (query_observers() == 1 && behaviour_call_out == 0)
          behaviour_call_out = call_out("behaviour_call", delay_time);
    }
@@ -297,6 +448,8 @@ void action_movement()
    env = environment();
    env->add_hook("object_arrived", arrival_fn);
    env->add_hook("object_left", departure_fn);
+   if (query_observers())
+      wake_behaviour();
    if (behaviour_call_out == 0 && query_observers())
       behaviour_call_out = call_out("behaviour_call", delay_time);
 }
@@ -306,15 +459,57 @@ int debugging()
    return objectp(debugee);
 }
 
-void debug(mixed s)
+//: FUNCTION record_trace
+// Add a line to the trace ring buffer, and show it to whoever is debugging
+// us. Use BT_TRACE() rather than calling this, so nothing is formatted
+// while tracing is off.
+void record_trace(mixed s)
 {
+   if (!trace_ring)
+      trace_ring = allocate(TRACE_SIZE);
+   trace_ring[trace_next % TRACE_SIZE] = stringp(s) ? s : sprintf("%O", s);
+   trace_next++;
    if (debugee && debugee->is_body())
       tell(debugee, sprintf("%s: %O\n", __FILE__, (s)));
 }
 
+void debug(mixed s)
+{
+   BT_TRACE(s);
+}
+
+//: FUNCTION set_trace
+// Start or stop recording the last TRACE_SIZE evaluation steps. Starting
+// clears what was recorded before. See query_trace().
+void set_trace(int on)
+{
+   trace_recording = on;
+   tracing = trace_recording || objectp(debugee);
+   if (on)
+   {
+      trace_ring = 0;
+      trace_next = 0;
+   }
+}
+
+//: FUNCTION query_trace
+// Returns the recorded trace lines, oldest first.
+string *query_trace()
+{
+   int start;
+
+   if (!trace_ring)
+      return ({});
+   if (trace_next <= TRACE_SIZE)
+      return trace_ring[0..trace_next - 1];
+   start = trace_next % TRACE_SIZE;
+   return trace_ring[start..] + trace_ring[0..start - 1];
+}
+
 void debug_me(int i)
 {
    debugee = i ? this_body() : 0;
+   tracing = trace_recording || objectp(debugee);
 }
 
 void set_blackboard(string key, mixed value)
@@ -327,6 +522,15 @@ void del_blackboard(string key)
    map_delete(blackboard, key);
 }
 
+//: FUNCTION signal_blackboard
+// Set a blackboard entry and wake the tree if it is dormant, so that other
+// objects can get a sleeping NPC to react to something.
+void signal_blackboard(string key, mixed value)
+{
+   set_blackboard(key, value);
+   wake_behaviour();
+}
+
 mixed blackboard(string key)
 {
    return blackboard[key];
@@ -469,6 +673,7 @@ void add_child(string node, string child)
    else
       node_list[node].children += ({child});
    parents[child] = node;
+   tree_compiled = 0;
 }
 
 private
@@ -493,7 +698,12 @@ void start_behaviour()
 {
    if (!node_list)
       init_tree();
+   if (!tree_compiled)
+      compile_tree();
    add_hook("move", ( : action_movement:));
+   add_hook("damaged", ( : behaviour_damaged:));
+   last_observed = time();
+   BEHAVIOUR_D->set_tree_dormant(dormant);
    if (env = environment(this_object()))
    {
       env->add_hook("object_arrived", arrival_fn);
@@ -506,12 +716,14 @@ void start_behaviour()
 
 void stop_behaviour_call()
 {
-   remove_call_out(behaviour_call_out);
+   if (behaviour_call_out)
+      remove_call_out(behaviour_call_out);
+   behaviour_call_out = 0;
 }
 
 string base_features()
 {
-   return "<051>Base functionality: \n<res>" + "\t- Emotions\n" + "\t- Basic call out\n" +
+   return "<051>Base functionality: \n<res>" + "\t- Emotions\n" + "\t- Basic call out\n" + "\t- Dormancy when unobserved\n" +
           "\t- Establish root sequence\n\n";
 }
 
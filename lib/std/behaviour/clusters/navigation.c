@@ -107,7 +107,6 @@ int do_wander()
    int i;
    string chosen_dir;
    string file;
-   object dest;
 
    if (environment(this_object()))
       directions = environment(this_object())->query_exit_directions();
@@ -119,26 +118,21 @@ int do_wander()
    chosen_dir = directions[random(i)];
 
    file = environment(this_object())->query_exit_destination(chosen_dir);
-   /* If the destination is not loaded, do so */
-   dest = find_object(file);
+   if (!file || file == "")
+      return EVAL_FAILURE;
 
-   if (!dest)
-      dest = load_object(file);
-
-   /* Check if the npc has wander restrictions */
-   if (dest && sizeof(wander_area))
+   /* Check if the npc has wander restrictions. The room graph knows the
+    * areas, so the destination is not loaded just to ask. */
+   if (sizeof(wander_area))
    {
-      if (arrayp(wander_area) && arrayp(dest->query_area()))
+      if (ROOM_GRAPH_D->room_in_area(file, wander_area) == 1)
       {
-         if (sizeof(wander_area & dest->query_area()))
-         {
-            move_me(chosen_dir);
-            return EVAL_SUCCESS;
-         }
-         return EVAL_FAILURE;
+         move_me(chosen_dir);
+         return EVAL_SUCCESS;
       }
+      return EVAL_FAILURE;
    }
-   else if (move_allowed)
+   else if (move_allowed && ROOM_GRAPH_D->room_exists(file))
    {
       move_me(chosen_dir);
       return EVAL_SUCCESS;
@@ -146,6 +140,23 @@ int do_wander()
    return EVAL_FAILURE;
 }
 
+//: FUNCTION go_towards
+// Take one step along the shortest known route to the given room, keeping
+// to the wander area if one is set. Returns EVAL_SUCCESS if a step was
+// taken, and EVAL_FAILURE if there is no route or we are already there.
+int go_towards(string room)
+{
+   string dir;
+
+   if (!environment() || (!sizeof(wander_area) && !move_allowed))
+      return EVAL_FAILURE;
+   dir = ROOM_GRAPH_D->next_step(file_name(environment()), room, sizeof(wander_area) ? wander_area : 0);
+   if (!dir)
+      return EVAL_FAILURE;
+   move_me(dir);
+   return EVAL_SUCCESS;
+}
+
 int wimpy()
 {
    string badly_wounded = this_object()->badly_wounded();
@@ -183,5 +194,6 @@ int bored()
 
 string navigation_features()
 {
-   return "<039>Navigation:\n<res>" + "\t- Leave room if badly injured\n" + "\t- Leave the room if bored\n\n";
+   return "<039>Navigation:\n<res>" + "\t- Leave room if badly injured\n" + "\t- Leave the room if bored\n" +
+          "\t- Routes to rooms from the room graph\n\n";
 }
\ No newline at end of file
@@ -10,4 +10,7 @@ class node
    int delay;        // Internal number, set automatically
    int status;       // Internal number, status propagation
    int node_num;     // Internal number, count of children we ran
+   int id;           // Index in the compiled node table
+   int parent_id;    // Index of the parent, -1 for the root
+   int *child_ids;   // Indexes of the children, in order
 }
\ No newline at end of file
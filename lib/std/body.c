@@ -56,6 +56,7 @@ inherit __DIR__ "body/guilds";
 void heal_all();
 varargs void stop_fight(object);
 void reinstate_effects();
+void freeze_effects();
 
 // Global variables --
 private
@@ -235,6 +236,7 @@ void save_me()
       shell_ob->save_me();
 
    saved_items = save_to_string(1); // 1 meaning it is recursive.
+   freeze_effects();
 
    // Save to the body id, and not the user ID. Part of User menu change.
    unguarded(1, ( : save_object, USER_PATH(bodyid) :));
@@ -371,6 +373,13 @@ int id(string arg)
    return ::id(arg);
 }
 
+string *query_name_words()
+{
+   string invis = query_invis_name();
+
+   return ::query_name_words() + (invis ? ({lower_case(invis)}) : ({}));
+}
+
 string stat_me()
 {
    string result = short() + "\n" + "Userid: " + query_userid() + "\n" + ::stat_me();
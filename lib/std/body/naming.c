@@ -141,6 +141,7 @@ void set_nickname(string arg)
    nickname = arg;
    add_id_no_plural(nickname);
    parse_refresh();
+   USER_D->refresh_body_names();
 }
 
 string query_nickname()
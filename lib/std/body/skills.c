@@ -45,6 +45,17 @@
 **
 **   All these parameters are set in the config/skills.h file.
 **
+** STORAGE
+**
+**   The skills mapping (name -> class skill) is what gets saved.  For the
+**   work done on every test_skill(), the same classes are also kept in an
+**   array indexed by the skill ids of SKILL_D's skill table, so walking up
+**   the tree follows the table's parent ids instead of cutting names up.
+**   The array is built from the mapping whenever the mapping is replaced,
+**   such as by a restore, so old save files load as they always did.
+**   The weighted sums behind aggregate_skill() are cached per skill until
+**   the points of the skill or one of its parents change.
+**
 ** Note: policy decision says that we aren't protecting skills from
 **       "unauthorized" tampering.  This is consistent with much of
 **       lib -- wizards can help players in any numbers of ways and
@@ -63,8 +74,96 @@ nosave mapping skill_ranks = ([]);
 private
 nosave mixed ranks = SKILL_D->ranks();
 
+/* our copy of SKILL_D's skill table, see query_skill_table() there */
+private
+nosave mapping skill_ids;
+private
+nosave string *skill_names;
+private
+nosave int *skill_parents;
+private
+nosave int *skill_depths;
+
+/* the classes in skills by skill id, and the mapping they came from */
+private
+nosave mixed *by_id;
+private
+nosave mapping indexed;
+
+/* skill id -> ({ weighted sum of points, divisor }) for aggregate_skill() */
+private
+nosave mapping aggregates = ([]);
+
 int base_test_skill(string skill, int opposing_skill);
 
+private
+void index_skills(int reload)
+{
+   if (reload || !skill_ids)
+   {
+      mixed *table = SKILL_D->query_skill_table();
+
+      skill_ids = table[0];
+      skill_names = table[1];
+      skill_parents = table[2];
+      skill_depths = table[3];
+   }
+
+   by_id = allocate(sizeof(skill_names));
+   foreach (string name, class skill cs in skills)
+   {
+      int id = skill_ids[name];
+
+      if (!undefinedp(id) && id < sizeof(by_id))
+         by_id[id] = cs;
+   }
+   indexed = skills;
+   aggregates = ([]);
+}
+
+/* Returns the id of the skill, or -1 if it isn't a skill */
+private
+int skill_index(string skill)
+{
+   int id;
+
+   if (indexed != skills)
+      index_skills(0);
+
+   id = skill_ids[skill];
+   if (undefinedp(id))
+   {
+      id = SKILL_D->query_skill_id(skill);
+      if (id == -1)
+         return -1;
+      /* new since we took our copy of the table, or SKILL_D was reloaded */
+      index_skills(1);
+      if (skill_ids[skill] != id)
+         return -1;
+   }
+
+   return id;
+}
+
+/* The points of the skill changed; forget the sums that count them */
+private
+void skill_changed(int changed)
+{
+   int depth = skill_depths[changed];
+
+   foreach (int id, mixed sum in aggregates)
+   {
+      if (!sum)
+         continue;
+      for (int i = id; i != -1 && skill_depths[i] >= depth; i = skill_parents[i])
+         if (i == changed)
+         {
+            aggregates[id] = 0;
+            break;
+         }
+   }
+}
+
 //: FUNCTION initiate_ranks
 // int initiate_ranks();
 // Function to build our cache of current skill ranks.
@@ -146,19 +245,25 @@ mapping query_skill_ranks()
 class skill set_skill(string skill, int skill_points, int training_points)
 {
    class skill cs = skills[skill];
+   int id;
 
-   if (member_array(skill, SKILL_D->query_skills()) == -1)
+   if (!SKILL_D->valid_skill(skill))
       error("illegal skill '" + skill + "'; cannot set new skill values.\n");
 
    if (!cs)
    {
       cs = skills[skill] = new (class skill, skill_points : skill_points, training_points : training_points);
+      if ((id = skill_index(skill)) != -1)
+         by_id[id] = cs;
    }
    else
    {
       cs.skill_points = skill_points;
       cs.training_points = training_points;
+      id = skill_index(skill);
    }
+   if (id != -1)
+      skill_changed(id);
 
    return cs;
 }
@@ -202,9 +307,10 @@ void clean_skills()
 {
    foreach (string skill in keys(skills))
    {
-      if (member_array(skill, SKILL_D->query_skills()) == -1)
+      if (!SKILL_D->valid_skill(skill))
          map_delete(skills, skill);
    }
+   indexed = 0;
 }
 
 //: FUNCTION query_skill
@@ -245,9 +351,36 @@ int query_training_pts(string skill)
 // skills.
 int aggregate_skill(string skill)
 {
+   int id = skill_index(skill);
+   int *sum;
    int total_skill = 0;
    int coef = 1;
 
+   if (id != -1)
+   {
+      /*
+      ** The parent at distance n counts 1/AGGREGATION_FACTOR^n; summing
+      ** the points scaled up by AGGREGATION_FACTOR^depth keeps it exact
+      ** until the one fuzzy_divide() at the end.
+      */
+      if (!(sum = aggregates[id]))
+      {
+         for (int d = skill_depths[id]; d--;)
+            coef *= AGGREGATION_FACTOR;
+         sum = ({0, coef});
+         for (int i = id; i != -1; i = skill_parents[i])
+         {
+            if (by_id[i])
+               sum[0] += ((class skill)by_id[i])->skill_points * coef;
+            coef /= AGGREGATION_FACTOR;
+         }
+         aggregates[id] = sum;
+      }
+      return fuzzy_divide(sum[0], sum[1]);
+   }
+
+   /* not a skill SKILL_D knows about, but we may have kept it */
+
    while (1)
    {
       class skill my_skill;
@@ -276,15 +409,26 @@ int aggregate_skill(string skill)
 // as appropriate.
 void learn_skill(string skill, int value)
 {
+   int id = skill_index(skill);
+   int top;
+
+   if (id == -1)
+   {
+      /* set_skill() complains about the skill for us */
+      set_skill(skill, 0, 0);
+      return;
+   }
+
    initiate_ranks();
    while (1)
    {
       class skill my_skill;
       int divisor;
-      int i;
       int s;
 
-      my_skill = skills[skill];
+      top = id;
+      skill = skill_names[id];
+      my_skill = by_id[id];
       if (!my_skill)
       {
          /* use set_skill() for verification of the skill */
@@ -312,11 +456,13 @@ void learn_skill(string skill, int value)
       if (!value)
          break;
 
-      i = strsrch(skill, '/', -1);
-      if (i == -1)
+      id = skill_parents[id];
+      if (id == -1)
          break;
-      skill = skill[0..i - 1];
    }
+
+   /* everything below the highest skill that changed counts its points */
+   skill_changed(top);
 }
 
 //: FUNCTION test_skill
@@ -16,6 +16,12 @@
 #include <move.h>
 #include <setbit.h>
 
+#ifdef USE_SIZE
+#define MEASURE(ob) (ob)->query_size()
+#else
+#define MEASURE(ob) (ob)->query_mass()
+#endif
+
 /*
  * INHERIT
  */
@@ -56,6 +62,51 @@ string default_relation; /* The default relation used for this
                           * It should usually be "in" but
                           * not necessarily */
 
+/* The mass held in each relation is a running total, adjusted as objects
+ * come and go or change mass, rather than summed whenever it is asked for.
+ * counted[ob] is ({ relation, mass }) for the mass ob was last counted with.
+ */
+private
+nosave mapping relation_mass = ([]);
+private
+nosave mapping counted = ([]);
+
+/* Contents sorted into groups of identical objects for inventory listings,
+ * keyed by relation ("#all#" for the whole inventory), see query_groups().
+ * Each entry is ({ number of objects grouped, groups }).
+ */
+private
+nosave mapping groups = ([]);
+
+/* Contents indexed by the words they answer to, see query_named().
+ * name_index[word] is ([ ob : 1 ]) and indexed[ob] the words ob was last
+ * indexed under.  Objects without query_name_words() are in unnamed, and
+ * match any word.
+ */
+private
+nosave mapping name_index = ([]);
+private
+nosave mapping indexed = ([]);
+private
+nosave mapping unnamed = ([]);
+/* Contents whose names changed since they were indexed */
+private
+nosave mapping renamed = ([]);
+
+/* While held > 0 the bookkeeping for objects coming and going is saved up
+ * and done once by release_bookkeeping(), see hold_bookkeeping().
+ */
+private
+nosave int held;
+private
+nosave int held_changes;
+private
+nosave int held_light;
+
+/* Objects cloned by set_objects() and set_unique_objects() */
+private
+nosave mapping reset_objects = ([]);
+
 int contained_light;
 int contained_light_added;
 mixed all_hidden_func;
@@ -92,6 +143,8 @@ nomask int valid_relation(string relation)
 // Return the relation which the given object is conatained by
 string query_relation(object ob)
 {
+   if (counted[ob])
+      return counted[ob][0];
    foreach (string test, class relation_data values in relations)
       if (member_array(ob, values.contents) > -1)
          return test;
@@ -244,11 +297,222 @@ string query_default_relation()
 
 /********    Capacity   ********/
 
+float query_total_capacity();
+varargs mapping verify_capacity(int fix);
+
+/* Tell our environment that our mass changed; it in turn tells its own. */
+private
+void propagate_mass()
+{
+   object env = environment();
+
+   if (env)
+      env->update_capacity();
+}
+
+//: FUNCTION invalidate_groups
+// Throws away the grouping kept by query_groups().  Called when our
+// contents change, and by contained objects when something that decides
+// their group changes, such as a flag or their names.  Our environment
+// is told as well, since it lists our contents and our ob_state()
+// depends on them; livings don't show their inventory, so it stops there.
+void invalidate_groups()
+{
+   object env = environment();
+
+   groups = ([]);
+   if (env && !this_object()->is_living())
+      env->invalidate_groups();
+}
+
+private
+void index_out(object ob)
+{
+   string *words = indexed[ob];
+
+   map_delete(indexed, ob);
+   map_delete(unnamed, ob);
+   map_delete(renamed, ob);
+   if (!words)
+      return;
+   foreach (string word in words)
+   {
+      if (!name_index[word])
+         continue;
+      map_delete(name_index[word], ob);
+      if (!sizeof(name_index[word]))
+         map_delete(name_index, word);
+   }
+}
+
+private
+void index_in(object ob)
+{
+   string *words = ob->query_name_words();
+
+   index_out(ob);
+   if (!arrayp(words))
+   {
+      indexed[ob] = ({});
+      unnamed[ob] = 1;
+      return;
+   }
+   indexed[ob] = words;
+   foreach (string word in words)
+   {
+      if (!name_index[word])
+         name_index[word] = ([]);
+      name_index[word][ob] = 1;
+   }
+}
+
+//: FUNCTION update_name_index
+// Called by a contained object when its ids, plurals or adjectives change.
+// It is indexed under its new names at the next query_named().
+void update_name_index()
+{
+   object ob = previous_object();
+
+   if (indexed[ob])
+      renamed[ob] = 1;
+}
+
+//: FUNCTION query_named
+// Returns the contents that may answer to the word, without asking each
+// of them with id().  The word is one of their ids, plurals or adjectives,
+// but check with id() or plural_id() which it is.
+object *query_named(string word)
+{
+   object *obs;
+
+   /* move_object() and destruct() can bypass receive_object() and
+    * release_object(), so index everything again if the count is off */
+   if (sizeof(indexed) != sizeof(all_inventory()))
+   {
+      name_index = ([]);
+      indexed = ([]);
+      unnamed = ([]);
+      renamed = ([]);
+      foreach (object ob in all_inventory())
+         index_in(ob);
+   }
+   if (sizeof(renamed))
+   {
+      foreach (object ob in keys(renamed))
+         if (ob)
+            index_in(ob);
+      renamed = ([]);
+   }
+   obs = name_index[word] ? keys(name_index[word]) : ({});
+   /* Objects without names can't be ruled out */
+   if (sizeof(unnamed))
+      obs += keys(unnamed);
+   return filter(obs, ( : $1 && environment($1) == this_object() :));
+}
+
+/* Our contents changed: group them again, and tell our environment
+ * about the change and our new mass, unless that is being held. */
+private
+void contents_changed(int mass_changed)
+{
+   if (held)
+   {
+      groups = ([]);
+      held_changes = 1;
+      return;
+   }
+   invalidate_groups();
+   if (mass_changed)
+      propagate_mass();
+}
+
+private
+void count_in(object ob, string relation)
+{
+   float m = MEASURE(ob);
+
+   index_in(ob);
+   counted[ob] = ({relation, m});
+   relation_mass[relation] += m;
+   contents_changed(m != 0.0);
+}
+
+private
+void count_out(object ob)
+{
+   mixed *entry = counted[ob];
+
+   index_out(ob);
+   if (!entry)
+   {
+      contents_changed(0);
+      return;
+   }
+   map_delete(counted, ob);
+   relation_mass[entry[0]] -= entry[1];
+   /* Start again from zero so rounding errors can't build up */
+   if (!sizeof(counted))
+      relation_mass = ([]);
+   contents_changed(entry[1] != 0.0);
+}
+
+//: FUNCTION hold_bookkeeping
+// Saves up the work done each time an object enters or leaves us -
+// grouping the contents again, passing our new mass and light up to our
+// environment - until release_bookkeeping(), which does it once.  Used
+// when moving many objects at once, see move_many().  Holds nest.
+void hold_bookkeeping()
+{
+   held++;
+}
+
+//: FUNCTION release_bookkeeping
+// Ends a hold_bookkeeping(), catching up on what was saved up.
+void release_bookkeeping()
+{
+   int light;
+
+   if (!held || --held)
+      return;
+   if (held_changes)
+   {
+      held_changes = 0;
+      invalidate_groups();
+      propagate_mass();
+   }
+   if (light = held_light)
+   {
+      held_light = 0;
+      if (inventory_visible())
+         adjust_light(light);
+   }
+}
+
+//: FUNCTION update_capacity
+// Called by a contained object when its mass has changed, see set_mass().
+// The total for its relation is adjusted by the difference and our own
+// environment is told in turn, so the change travels up the chain of
+// containers without anything being summed again.
+void update_capacity()
+{
+   object ob = previous_object();
+   mixed *entry = counted[ob];
+   float m;
+
+   if (!entry)
+      return;
+   m = MEASURE(ob);
+   if (m == entry[1])
+      return;
+   relation_mass[entry[0]] += m - entry[1];
+   entry[1] = m;
+   propagate_mass();
+}
+
 //: FUNCTION query_capacity
 // Returns the amount of mass currently attached to a container
 varargs float query_capacity(string relation)
 {
-   float cap = 0.0;
    string aliased_to;
    /* Need a little special handling for #CLONE# */
    if (!relation || relation == "" || relation == "#CLONE#")
@@ -261,20 +525,50 @@ varargs float query_capacity(string relation)
          return 0;
       relation = aliased_to;
    }
-   foreach (object ob in relations[relation].contents)
+#ifdef VERIFY_CONTAINER_MASS
+   if (verify_capacity())
+      error("Contained mass of " + file_name() + " does not match its contents.\n");
+#endif
+   return relation_mass[relation];
+}
+
+//: FUNCTION verify_capacity
+// Recounts the contents of every relation and compares them with the
+// running totals.  Returns 0 if they agree, otherwise a mapping of
+// relation -> ({ running total, recount }) for the ones that don't.
+// verify_capacity(1) also replaces the totals with the recount.
+// Each container checks only its own contents; the mass of a nested
+// container is taken from its own total.
+varargs mapping verify_capacity(int fix)
+{
+   mapping wrong = ([]);
+   mapping recount = ([]);
+   mapping entries = ([]);
+
+   foreach (string relation, class relation_data data in relations)
    {
-      if (!ob)
+      float m = 0.0;
+
+      data.contents -= ({0});
+      foreach (object ob in data.contents)
       {
-         relations[relation].contents -= ({ob});
-         continue;
+         entries[ob] = ({relation, MEASURE(ob)});
+         m += entries[ob][1];
       }
-#ifdef USE_SIZE
-      cap += ob->query_size();
-#else
-      cap += ob->query_mass();
-#endif
+      recount[relation] = m;
+      if (abs(m - relation_mass[relation]) > 0.001)
+         wrong[relation] = ({relation_mass[relation], m});
+   }
+   if (fix)
+   {
+      float before = query_total_capacity();
+
+      counted = entries;
+      relation_mass = recount;
+      if (query_total_capacity() != before)
+         propagate_mass();
    }
-   return cap;
+   return sizeof(wrong) ? wrong : 0;
 }
 
 //: FUNCTION set_max_capacity
@@ -313,16 +607,21 @@ varargs int query_max_capacity(string relation)
    return relations[relation].max_capacity;
 }
 
-// ### Yo! finish this -- Tigran
 //: FUNCTION query_total_capacity
-// Returns the capacity directly attributed to the container.  This should
-// normally include anything attached or within the container.
-int query_total_capacity()
+// Returns the capacity directly attributed to the container.  This
+// includes anything attached or within the container.
+float query_total_capacity()
 {
+   float total = 0.0;
+
+   foreach (string relation, float m in relation_mass)
+      total += m;
+   return total;
 }
 #ifdef USE_MASS
 //: FUNCTION query_mass
-int query_mass()
+// Our own mass plus the mass of everything we hold.
+float query_mass()
 {
    return query_total_capacity() + ::query_mass();
 }
@@ -340,7 +639,6 @@ int query_aggregate_size()
 // returns a value from <move.h> if there is an error
 mixed receive_object(object target, string relation)
 {
-   int x, m;
    string aliased_to;
    if (!relation || relation == "" || relation == "#CLONE#")
       relation = query_default_relation();
@@ -357,17 +655,12 @@ mixed receive_object(object target, string relation)
       relation = aliased_to;
    }
 
-#ifdef USE_SIZE
-   x = target->query_size();
-#else
-   x = target->query_mass();
-#endif
-
-   if ((m = (query_capacity(relation)) + x) > query_max_capacity(relation))
+   if (query_capacity(relation) + MEASURE(target) > query_max_capacity(relation))
    {
       return MOVE_NO_ROOM;
    }
    relations[relation].contents += ({target});
+   count_in(target, relation);
    return 1;
 }
 
@@ -377,10 +670,13 @@ mixed receive_object(object target, string relation)
 varargs mixed release_object(object target, int force)
 {
    string relation;
-   if (!target || force)
+   if (!target)
       return 1;
    relation = query_relation(target);
-   if (!relation && !force)
+   count_out(target);
+   if (force)
+      return 1;
+   if (!relation)
       return 0;
    relations[relation].contents -= ({target});
    return 1;
@@ -391,10 +687,36 @@ void reinsert_object(object target, string relation)
    if (!relation)
       relation = query_default_relation();
    relations[relation].contents += ({target});
+   count_in(target, relation);
 }
 
 /********   Descriptions    ********/
 
+//: FUNCTION query_groups
+// Returns the contents of the relation sorted into groups of identical
+// objects by group_objects(), or all of our inventory with no relation.
+// The grouping is kept until our contents change, see invalidate_groups().
+varargs mixed *query_groups(string relation)
+{
+   object *obs;
+   string key = relation || "#all#";
+   mixed *entry;
+
+   if (!relation)
+      obs = all_inventory();
+   else if (relations[relation])
+      obs = relations[relation].contents;
+   else
+      return ({});
+
+   /* move_object() can bypass receive_object(), so check the count too */
+   if ((entry = groups[key]) && entry[0] == sizeof(obs))
+      return entry[1];
+   entry = ({sizeof(obs), group_objects(obs)});
+   groups[key] = entry;
+   return entry[1];
+}
+
 string long()
 {
    string res;
@@ -406,7 +728,7 @@ string long()
 
    foreach (string rel, class relation_data data in relations)
    {
-      contents = inv_list(data.contents, 1);
+      contents = inv_list_groups(query_groups(rel), 1);
       if (contents)
       {
          res += introduce_contents(rel) + contents;
@@ -448,7 +770,7 @@ string look_in(string relation)
       relation = aliased_to;
    }
 
-   inv = inv_list(relations[relation].contents);
+   inv = inv_list_groups(query_groups(relation));
    if (!inv)
       inv = "  nothing";
 
@@ -632,6 +954,7 @@ mixed *make_objects_if_needed()
             }
             else
                ob->on_clone(rest...);
+            reset_objects[ob] = 1;
             matches += ({ob});
          }
          objs += matches;
@@ -692,6 +1015,7 @@ mixed *make_unique_objects_if_needed()
             if (ret != MOVE_OK)
                error("Initial clone failed for '" + file + "': " + ret + "\n");
             ob->on_clone(rest...);
+            reset_objects[ob] = 1;
             matches += ({ob});
          }
          objs += matches;
@@ -700,6 +1024,27 @@ mixed *make_unique_objects_if_needed()
    return objs;
 }
 
+//: FUNCTION query_reset_object
+// Returns 1 if the object was cloned by us from set_objects() or
+// set_unique_objects(), and so would come back on its own if we were
+// loaded again.
+int query_reset_object(object ob)
+{
+   return reset_objects[ob];
+}
+
+//: FUNCTION query_reset_missing
+// Returns 1 if something we cloned from set_objects() or
+// set_unique_objects() has been destroyed or taken away, and the next
+// reset has not run yet to put it back.
+int query_reset_missing()
+{
+   foreach (object ob in keys(reset_objects))
+      if (!ob || environment(ob) != this_object())
+         return 1;
+   return 0;
+}
+
 //: FUNCTION set_objects
 // Provide a list of objects to be loaded now and at every reset.  The key
 // should be the filename of the object, and the value should be the number
@@ -789,6 +1134,7 @@ varargs string inventory_recurse(int depth, mixed avoid)
    int i;
    string str = "";
    string tmp;
+   mixed *sorted;
 
    if (avoid)
    {
@@ -819,7 +1165,10 @@ varargs string inventory_recurse(int depth, mixed avoid)
       foreach (string key, mixed data in relations)
       {
          res = introduce_contents(key);
-         tmp = inv_list(data.contents - avoid, 1, depth);
+         sorted = query_groups(key);
+         if (sizeof(avoid))
+            sorted = map(sorted, ( : $1 - $(avoid) :));
+         tmp = inv_list_groups(sorted, 1, depth);
          if (tmp)
          {
             for (i = 0; i < depth; i++)
@@ -925,6 +1274,12 @@ void containee_light_changed(int adjustment)
 {
    contained_light += adjustment;
 
+   if (held)
+   {
+      held_light += adjustment;
+      return;
+   }
+
    /*
    ** if the containee is visible, then tweak our own light; this will
    ** propagate on up to the room
@@ -984,6 +1339,8 @@ string stat_me()
 
 void reset()
 {
+   /* Whatever is gone now is replaced, or can't be */
+   reset_objects = filter(reset_objects, ( : $1 && environment($1) == this_object() :));
    make_objects_if_needed();
    make_unique_objects_if_needed();
 }
@@ -14,6 +14,9 @@
 ** of the grid.  They are in north, east, south, west order; one line
 ** per grid spot.
 **
+** materialise_region() loads a rectangle of rooms ahead of time, a batch
+** per call_out.
+**
 ** Deathblade, 960101: created
 */
 
@@ -37,6 +40,9 @@ nosave private string brief_desc;
 #define SOUTH_EDGE(x) edge_rooms[(x) + GRID_WIDTH + GRID_HEIGHT]
 #define WEST_EDGE(y) edge_rooms[(y) + 2 * GRID_WIDTH + GRID_HEIGHT]
 
+// Rooms loaded per call_out by materialise_region()
+#define MATERIALISE_BATCH 50
+
 void create()
 {
    set_privilege(1);
@@ -93,6 +99,8 @@ object virtual_create(string arg)
 
    x = to_int(arg[0..idx - 1]);
    y = to_int(arg[idx + 1..]);
+   if (x < 0 || y < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT)
+      return 0;
 
    if (y == 0)
       exit_n = NORTH_EDGE(x);
@@ -125,6 +133,50 @@ object virtual_create(string arg)
    return room;
 }
 
+private
+void materialise_batch(string *todo, object *loaded, function done)
+{
+   object room;
+
+   foreach (string name in todo[0..MATERIALISE_BATCH - 1])
+   {
+      room = 0;
+      catch (room = load_object(name));
+      if (room)
+         loaded += ({room});
+   }
+   todo = todo[MATERIALISE_BATCH..];
+   if (sizeof(todo))
+      call_out(( : materialise_batch:), 0, todo, loaded, done);
+   else if (done)
+      evaluate(done, loaded);
+}
+
+//: FUNCTION materialise_region
+// Loads the rooms from (x1, y1) to (x2, y2), MATERIALISE_BATCH of them per
+// call_out so a large region stays under the eval limit.  Rooms already
+// loaded are skipped.  If given, done is called with the rooms loaded once
+// the whole region is.  Returns the number of rooms to load.
+varargs int materialise_region(int x1, int y1, int x2, int y2, function done)
+{
+   string *todo = ({});
+
+   x1 = max(({x1, 0}));
+   y1 = max(({y1, 0}));
+   x2 = min(({x2, GRID_WIDTH - 1}));
+   y2 = min(({y2, GRID_HEIGHT - 1}));
+   for (int y = y1; y <= y2; y++)
+      for (int x = x1; x <= x2; x++)
+         if (!find_object(GRID_ROOM(x, y)))
+            todo += ({GRID_ROOM(x, y)});
+
+   if (sizeof(todo))
+      materialise_batch(todo, ({}), done);
+   else if (done)
+      evaluate(done, ({}));
+   return sizeof(todo);
+}
+
 // Disappear if no longer needed
 protected
 void clean_up()
@@ -4,9 +4,15 @@
 
 inherit CLASS_EFFECT;
 
+// Saved form of the effects queue, ordered by due time with each delay
+// relative to the previous effect. Only used across save/restore; see
+// freeze_effects() and reinstate_effects().
 private
-mixed *effects = ({});  // Queue of effects to call
-nosave private int tag; // Tag for call_out
+mixed *effects = ({});
+
+// Live effects, EFFECTS_D handle -> effect. While an effect is live its
+// delay field holds the absolute time it is next due.
+nosave private mapping active = ([]);
 
 //: MODULE
 // Handles effects (ie delayed/repeating events)
@@ -17,19 +23,35 @@ nosave private int tag; // Tag for call_out
 // Each of these functions takes arguments : effect sufferer, args, counter
 //  where counter is the number of times it will repeat
 //  args is a mixed set of args as appropriate to the effect
+//
+// Scheduling is done by EFFECTS_D, which keeps one call_out for the
+// earliest effect on the whole mud. Effects are identified by the handle
+// EFFECTS_D hands out, and the "index" functions below return handles.
+
+private
+int compare_due(class effect_class a, class effect_class b)
+{
+   return a.delay - b.delay;
+}
+
+private
+class effect_class *effect_queue()
+{
+   return sort_array(values(active), ( : compare_due:));
+}
 
 //: FUNCTION time_to_next_effect
-// Returns time remaining in call_out to the next effect
+// Returns time remaining until the next effect, or -1 if there is none
 int time_to_next_effect()
 {
-   mixed *callouts = call_out_info();
-   foreach (mixed callout in callouts)
-   {
-      if (callout[0] == this_object())
-         if (callout[1] == "next_effect")
-            return callout[2];
-   }
-   return -1;
+   int next = -1;
+
+   foreach (int handle, class effect_class effect in active)
+      if (next == -1 || effect.delay < next)
+         next = effect.delay;
+   if (next == -1)
+      return -1;
+   return next > time() ? next - time() : 0;
 }
 
 //: FUNCTION actual_period
@@ -53,68 +75,63 @@ int actual_period(mixed val)
    return 0;
 }
 
-// ###TODO add "special case" for time adjustment for removal of first effect
-//  where call_out remaining should be used in place of delay
-
 //: FUNCTION remove_effect_at
-// Removes effect from queue at appropriate point
-void remove_effect_at(int pos)
+// Removes the effect with the given handle, without calling end_effect.
+// Return 1 on success, 0 on failure
+int remove_effect_at(int handle)
 {
-   effects[pos - 1].delay += effects[pos].delay;
-   effects = effects[0..pos - 1] + effects[pos + 1..];
+   if (!active[handle])
+      return 0;
+   EFFECTS_D->cancel_effect(handle);
+   map_delete(active, handle);
+   return 1;
 }
 
 //: FUNCTION find_effect_index
-// Return position of effect with specified object in queue
+// Return handle of the effect with specified object
 // Return -1 on failure
 int find_effect_index(string ob)
 {
    if (ob)
-      for (int i = 0; i < sizeof(effects); i++)
-      {
-         if (effects[i].effect_ob == ob)
-            return i;
-      }
+      foreach (int handle, class effect_class effect in active)
+         if (effect.effect_ob == ob)
+            return handle;
    return -1;
 }
 
 //: FUNCTION find_effect_name_index
-// Return position of effect with specified name in queue
+// Return handle of the effect with specified name
 // Return -1 on failure
 int find_effect_name_index(string name)
 {
    if (name)
-      for (int i = 0; i < sizeof(effects); i++)
-      {
-         if (effects[i].name == name)
-            return i;
-      }
+      foreach (int handle, class effect_class effect in active)
+         if (effect.name == name)
+            return handle;
    return -1;
 }
 
 //: FUNCTION find_effect_indexes_matching
-// Return array of positions of effects (part-)matching specified name
+// Return array of handles of effects (part-)matching specified name
 // Return ({})
 int *find_effect_indexes_matching(string name)
 {
    int *res = ({});
    if (name)
-      for (int i = 0; i < sizeof(effects); i++)
-      {
-         if (effects[i]->name[0..strlen(name)-1] == name)
-            res += ({i});
-      }
+      foreach (int handle, class effect_class effect in active)
+         if (effect.name && effect.name[0..strlen(name) - 1] == name)
+            res += ({handle});
    return res;
 }
 
 //: FUNCTION find_effect
-// Return effect with specified object in queue
+// Return effect with specified object
 // Return 0 on failure
-int find_effect(string ob)
+mixed find_effect(string ob)
 {
    int idx = find_effect_index(ob);
    if (idx > -1)
-      return effects[idx];
+      return active[idx];
    return 0;
 }
 
@@ -122,9 +139,9 @@ int find_effect(string ob)
 // Return args of specified effect
 mixed query_effect_args(string ob)
 {
-   int idx = find_effect_index(ob);
-   if (idx > -1)
-      return effects[idx].args;
+   class effect_class effect = find_effect(ob);
+   if (effect)
+      return effect.args;
    return 0;
 }
 
@@ -133,11 +150,7 @@ mixed query_effect_args(string ob)
 // Return 1 on success, 0 on failure
 int remove_effect(string ob)
 {
-   int index = find_effect_index(ob);
-   if (index > -1)
-      if (remove_effect_at(index))
-         return 1;
-   return 0;
+   return remove_effect_at(find_effect_index(ob));
 }
 
 //: FUNCTION remove_effect_named
@@ -145,11 +158,7 @@ int remove_effect(string ob)
 // Return 1 on success, 0 on failure
 int remove_effect_named(string name)
 {
-   int index = find_effect_name_index(name);
-   if (index > -1)
-      if (remove_effect_at(index))
-         return 1;
-   return 0;
+   return remove_effect_at(find_effect_name_index(name));
 }
 
 //: FUNCTION remove_effects_matching
@@ -158,96 +167,57 @@ int remove_effect_named(string name)
 int remove_effects_matching(string name)
 {
    int *matches = find_effect_indexes_matching(name);
-   if (sizeof(matches))
-   {
-      foreach (int idx in sort_array(matches, -1))
-         remove_effect_at(idx);
-      return 1;
-   }
-   return 0;
-}
-
-//: FUNCTION insert_effect_at
-// Inserts effect into queue at appropriate point
-void insert_effect_at(class effect_class effect, int pos)
-{
-   effects = effects[0..pos - 1] + ({effect}) + effects[pos..];
+   foreach (int handle in matches)
+      remove_effect_at(handle);
+   return sizeof(matches) > 0;
 }
 
 //: FUNCTION insert_effect
-// Finds appropriate point in queue to insert effect
-// Adjusts delay to following effect
-// Returns 1 on success, 0 on failure.
+// Schedules an effect to happen effect.delay seconds from now.
+// Returns the handle of the effect.
 int insert_effect(class effect_class effect)
 {
-   class effect_class this_effect = new (class effect_class);
-   int cum_delay, prev_delay;
+   int handle;
 
-   // If queue is empty, just put this effect in the queue
-   if (!effects || !sizeof(effects))
-   {
-      effects = ({effect});
-      return 1;
-   }
+   effect.delay += time();
+   handle = EFFECTS_D->schedule_effect(effect.delay);
+   active[handle] = effect;
+   return handle;
+}
 
-   // Walk through queue, calculating cumulative delay
-   // and when this exceeds delay required for the effect to be inserted
-   // insert the effect
-   for (int i = 0; i < sizeof(effects); i++)
-   {
-      this_effect = effects[i];
-      prev_delay = cum_delay;
-      cum_delay += this_effect.delay;
-      if (effect.delay < cum_delay)
-      {
-         insert_effect_at(effect, i);
-
-         // If there is an effect following this in the queue,
-         // adjust its relative delay
-         if (sizeof(effects) > i + 1)
-         {
-            this_effect.delay -= (effect.delay - cum_delay);
-            effects[i + 1] = this_effect;
-         }
-
-         // If there is an effect before this one in the queue,
-         // adjust the relative delay of this effect
-         if (sizeof(effects) > 1)
-         {
-            this_effect = effects[i];
-            this_effect.delay -= prev_delay;
-            effects[i] = this_effect;
-         }
-         return 1;
-      }
-   }
-   return 0;
+//: FUNCTION reschedule_effects
+// Called by a reloaded EFFECTS_D, which has lost the handles. Schedules
+// every live effect again for the time it was due.
+void reschedule_effects()
+{
+   mapping old = active;
+
+   if (base_name(previous_object()) != EFFECTS_D)
+      return;
+   active = ([]);
+   foreach (int handle, class effect_class effect in old)
+      active[EFFECTS_D->schedule_effect(effect.delay)] = effect;
 }
 
-//: FUNCTION next_effect
-// Call the function specified in the function at the head of the queue
-// Move it to appropriate place in queue
-// Then call out to next effect in the queue
-void next_effect()
+//: FUNCTION run_effect
+// Called by EFFECTS_D when an effect is due. Does whatever the effect
+// wants, then either schedules it again or ends it.
+void run_effect(int handle)
 {
-   class effect_class this_effect;
+   class effect_class this_effect = active[handle];
    object ob;
 
-   // Finish if the queue is empty
-   if (!effects || !sizeof(effects))
+   if (base_name(previous_object()) != EFFECTS_D || !this_effect)
       return;
 
-   // Do whatever the current head of the queue wants
-   this_effect = effects[0];
-
    ob = load_object(this_effect.effect_ob);
    if (!ob)
+   {
+      map_delete(active, handle);
       return;
+   }
 
-   // Remove head of queue
-   effects = effects[1..];
-
-   // If counter is not zero, move current effect to later in the queue
+   // If counter is not zero, schedule the effect again
    if (this_effect.counter != 0)
    {
       // If counter >0, decrease it
@@ -256,47 +226,63 @@ void next_effect()
 
       this_effect.args = ob->do_effect(this_object(), this_effect.args, this_effect.counter);
 
-      // Calculate delay to next occurence
-      this_effect.delay = actual_period(this_effect.interval);
+      // do_effect() may have removed it
+      if (!active[handle])
+         return;
 
-      // Put it into queue again
-      insert_effect(this_effect);
+      // Calculate delay to next occurence
+      this_effect.delay = time() + actual_period(this_effect.interval);
+      EFFECTS_D->schedule_effect(this_effect.delay, handle);
    }
    else
    {
+      map_delete(active, handle);
       ob->end_effect(this_object(), this_effect.args);
    }
-   // If there is anything in the queue, do a callout to it
-   if (sizeof(effects))
-   {
-      this_effect = effects[0];
-      tag = call_out("next_effect", this_effect.delay);
-   }
-   else
-      tag = 0;
 }
 
 //: FUNCTION clear_effects
 // Clears the effects queue
 void clear_effects()
 {
+   mapping old = active;
    object ob;
-   foreach (class effect_class effect in effects)
+
+   active = ([]);
+   effects = ({});
+   foreach (int handle, class effect_class effect in old)
    {
+      EFFECTS_D->cancel_effect(handle);
       ob = load_object(effect.effect_ob);
       if (ob)
          if (function_exists("end_effect", ob))
             ob->end_effect(this_object(), effect.args, effect.counter);
    }
-   effects = ({});
-   tag = 0;
 }
 
 //: FUNCTION query_effects
-// Returns copy of the effects queue
+// Returns copy of the effects queue, ordered by due time, with each delay
+// relative to the effect before it
 mixed *query_effects()
 {
-   return copy(effects);
+   mixed *queue = copy(effect_queue());
+   int last = time();
+   int due;
+
+   foreach (class effect_class effect in queue)
+   {
+      due = effect.delay;
+      effect.delay = due > last ? due - last : 0;
+      last = due > last ? due : last;
+   }
+   return queue;
+}
+
+//: FUNCTION freeze_effects
+// Writes the live effects into the saved queue. Call before save_object().
+void freeze_effects()
+{
+   effects = query_effects();
 }
 
 //: FUNCTION add_effect
@@ -325,22 +311,26 @@ void add_effect(string ob, mixed args, int repeats, mixed interval)
    if (function_exists("start_effect", obj))
       this_effect.args = obj->start_effect(this_object(), args, repeats, interval);
    insert_effect(this_effect);
-   if (!tag)
-      tag = call_out("next_effect", this_effect.delay);
 }
 
 //: FUNCTION reinstate_effects
-// Called on relogging to restart effects.
+// Called on relogging to restart effects from the saved queue.
 void reinstate_effects()
 {
    object ob;
+   int delay;
+
    foreach (class effect_class effect in effects)
    {
+      // Saved delays are relative to the effect before
+      delay += effect.delay;
       ob = load_object(effect.effect_ob);
       if (!ob)
          continue;
       if (function_exists("reinstate_effect", ob))
          effect.args = ob->reinstate_effect(this_object(), effect.args, effect.counter, );
+      effect.delay = delay;
+      insert_effect(effect);
    }
-   next_effect();
+   effects = ({});
 }
@@ -133,6 +133,9 @@ mixed query_base()
 void set_hidden(int i)
 {
    hidden = i;
+   /* The obvious exits line of the room changes */
+   if (environment())
+      environment()->description_changed();
 }
 
 //: FUNCTION query_hidden
@@ -14,6 +14,15 @@ mapping weaknesses = ([]);
 private
 int armor_class;
 
+/* Whoever wears us keeps our numbers in a mitigation profile, see
+ * armors_modify_event() in the adversary; tell them when they change. */
+private
+void mitigation_changed()
+{
+   if (environment())
+      environment()->invalidate_mitigation();
+}
+
 //: FUNCTION set_armor_class
 // Set the protection of the particular damage sink.  random(class) points
 // of damage will be prevented.
@@ -21,6 +30,7 @@ void set_armor_class(int x)
 {
    armor_class = x;
    this_object()->set_max_durability(ARMOR_DURA_PER_AC * x);
+   mitigation_changed();
 }
 
 //: FUNCTION query_armor_class
@@ -40,16 +50,31 @@ mapping query_weaknesses()
    return weaknesses;
 }
 
+//: FUNCTION query_mitigation
+// int *query_mitigation(mixed type)
+// Returns ({ weakness, resistance, resisted }) against damage of the given
+// type.  resisted is 1 if we resist it at all.  Weapons deal an array of
+// types, which is neither resisted nor a weakness.
+int *query_mitigation(mixed type)
+{
+   if (!stringp(type))
+      return ({0, 0, 0});
+   return ({weaknesses[type], resistances[type], !undefinedp(resistances[type])});
+}
+
 class event_info sink_modify_event(class event_info evt)
 {
-   int reduced = evt.data[1];
+   int reduced;
+   int *m;
+
    // TBUG(event_to_str(evt));
    if (stringp(evt.data))
       return evt;
-   if (member_array(evt.data[0], keys(weaknesses)) != -1)
-      evt.data[1] += weaknesses[evt.data[0]];
-   if (member_array(evt.data[0], keys(resistances)) != -1)
-      evt.data[1] -= resistances[evt.data[0]] + armor_class;
+   reduced = evt.data[1];
+   m = query_mitigation(evt.data[0]);
+   evt.data[1] += m[0];
+   if (m[2])
+      evt.data[1] -= m[1] + armor_class;
    else
       evt.data[1] -= ((armor_class / 2) + random(armor_class / 2));
    if (evt.data[1] < 0)
@@ -71,7 +96,10 @@ class event_info sink_modify_event(class event_info evt)
 void set_resist(string type, int amt)
 {
    if (DAMAGE_D->query_valid_damage_type(type))
+   {
       resistances[type] = amt;
+      mitigation_changed();
+   }
    else
       error(sprintf("Invalid damage type %s in %O\n", type, this_object()));
 }
@@ -85,6 +113,7 @@ void set_resistances(mapping x)
    if (sizeof(exclude))
       error("Invalid damage type(s) : " + implode(exclude, ","));
    resistances = x;
+   mitigation_changed();
 }
 
 //: FUNCTION set_weakness
@@ -93,7 +122,10 @@ void set_resistances(mapping x)
 void set_weakness(string type, int amt)
 {
    if (DAMAGE_D->query_valid_damage_type(type))
+   {
       weaknesses[type] = amt;
+      mitigation_changed();
+   }
    else
       error(sprintf("Invalid damage type %s in %O\n", type, this_object()));
 }
@@ -107,6 +139,7 @@ void set_weaknesses(mapping weak)
    if (sizeof(exclude))
       error("Invalid damage type(s) : " + implode(exclude, ","));
    weaknesses = weak;
+   mitigation_changed();
 }
 
 //: FUNCTION is_armor
@@ -123,6 +123,7 @@ int state_update()
 void stop_decay()
 {
    decays = 0;
+   stop_state_updates();
 }
 
 void mudlib_setup()
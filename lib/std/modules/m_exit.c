@@ -33,6 +33,7 @@ varargs mixed call_hooks(string tag, mixed func, mixed start, mixed *args...);
 mixed query_exit_check(string);
 mapping debug_exits();
 string *query_hidden_exits();
+void description_changed();
 
 /*
  * DEFAULTS AND ERRORS
@@ -410,6 +411,7 @@ void delete_exit(mixed direction)
    if (which && which->is_exit())
       destruct(which);
    map_delete(exits, direction);
+   description_changed();
 }
 
 //: FUNCTION add_exit
@@ -435,6 +437,7 @@ varargs void add_exit(mixed direction, mixed destination)
    else
       new_exit.checks = 1;
    exits[direction] = new_exit;
+   description_changed();
 #endif
 }
 
@@ -463,6 +466,7 @@ void set_hidden_exits(string *exits_list...)
       hidden_exits = keys(exits);
    else
       hidden_exits = exits_list;
+   description_changed();
 }
 
 //: FUNCTION add_hidden_exit
@@ -473,6 +477,7 @@ void add_hidden_exit(string *exits_list...)
       hidden_exits = query_exit_directions(1);
    else
       hidden_exits += exits_list;
+   description_changed();
 }
 
 //: FUNCTION remove_hidden_exit
@@ -483,6 +488,7 @@ void remove_hidden_exit(string *exits_list...)
       hidden_exits = 0;
    else
       hidden_exits -= exits_list;
+   description_changed();
 }
 
 //: FUNCTION query_hidden_exits
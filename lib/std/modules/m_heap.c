@@ -0,0 +1,169 @@
+/* Do not remove the headers from this file! see /USAGE for more info. */
+
+//: MODULE
+// Indexed binary min-heap of integer handles ordered by an integer key,
+// normally a due time. Every operation is O(log n) at worst; heap_peek()
+// and heap_contains() are O(1). Handles are chosen by the caller and must
+// be unique within the heap.
+//
+// Used by daemons that want a single call_out for their earliest deadline
+// instead of one call_out per pending event.
+
+private
+nosave int *heap_keys = allocate(16);
+private
+nosave int *heap_handles = allocate(16);
+private
+nosave int heap_count;
+private
+nosave mapping heap_pos = ([]);
+
+private
+void heap_set(int i, int handle, int key)
+{
+   heap_handles[i] = handle;
+   heap_keys[i] = key;
+   heap_pos[handle] = i;
+}
+
+private
+void heap_sift_up(int i)
+{
+   int handle = heap_handles[i];
+   int key = heap_keys[i];
+   int parent;
+
+   while (i > 0)
+   {
+      parent = (i - 1) / 2;
+      if (heap_keys[parent] <= key)
+         break;
+      heap_set(i, heap_handles[parent], heap_keys[parent]);
+      i = parent;
+   }
+   heap_set(i, handle, key);
+}
+
+private
+void heap_sift_down(int i)
+{
+   int handle = heap_handles[i];
+   int key = heap_keys[i];
+   int child;
+
+   while ((child = i * 2 + 1) < heap_count)
+   {
+      if (child + 1 < heap_count && heap_keys[child + 1] < heap_keys[child])
+         child++;
+      if (key <= heap_keys[child])
+         break;
+      heap_set(i, heap_handles[child], heap_keys[child]);
+      i = child;
+   }
+   heap_set(i, handle, key);
+}
+
+//: FUNCTION heap_size
+// Number of handles in the heap.
+int heap_size()
+{
+   return heap_count;
+}
+
+//: FUNCTION heap_contains
+// Returns 1 if the handle is in the heap.
+int heap_contains(int handle)
+{
+   return !undefinedp(heap_pos[handle]);
+}
+
+//: FUNCTION heap_key
+// Returns the key of a handle in the heap, or 0 if it is not there.
+int heap_key(int handle)
+{
+   mixed i = heap_pos[handle];
+
+   return undefinedp(i) ? 0 : heap_keys[i];
+}
+
+//: FUNCTION heap_insert
+// Adds a handle with the given key. A handle already in the heap is moved
+// to the new key instead.
+void heap_insert(int handle, int key)
+{
+   mixed i = heap_pos[handle];
+
+   if (!undefinedp(i))
+   {
+      heap_keys[i] = key;
+      heap_sift_up(i);
+      heap_sift_down(heap_pos[handle]);
+      return;
+   }
+   if (heap_count == sizeof(heap_keys))
+   {
+      heap_keys += allocate(heap_count);
+      heap_handles += allocate(heap_count);
+   }
+   heap_set(heap_count, handle, key);
+   heap_sift_up(heap_count++);
+}
+
+//: FUNCTION heap_remove
+// Removes a handle from the heap. Returns 0 if it was not there.
+int heap_remove(int handle)
+{
+   mixed i = heap_pos[handle];
+
+   if (undefinedp(i))
+      return 0;
+   map_delete(heap_pos, handle);
+   if (i != --heap_count)
+   {
+      int moved = heap_handles[heap_count];
+
+      heap_set(i, moved, heap_keys[heap_count]);
+      heap_sift_up(i);
+      heap_sift_down(heap_pos[moved]);
+   }
+   return 1;
+}
+
+//: FUNCTION heap_peek
+// Returns the handle with the smallest key without removing it, or -1 if
+// the heap is empty.
+int heap_peek()
+{
+   return heap_count ? heap_handles[0] : -1;
+}
+
+//: FUNCTION heap_peek_key
+// Returns the smallest key in the heap, or 0 if the heap is empty.
+int heap_peek_key()
+{
+   return heap_count ? heap_keys[0] : 0;
+}
+
+//: FUNCTION heap_pop
+// Removes and returns the handle with the smallest key, or -1 if the heap
+// is empty.
+int heap_pop()
+{
+   int handle;
+
+   if (!heap_count)
+      return -1;
+   handle = heap_handles[0];
+   heap_remove(handle);
+   return handle;
+}
+
+//: FUNCTION heap_clear
+// Empties the heap.
+void heap_clear()
+{
+   heap_keys = allocate(16);
+   heap_handles = allocate(16);
+   heap_count = 0;
+   heap_pos = ([]);
+}
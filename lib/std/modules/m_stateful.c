@@ -18,6 +18,14 @@ void internal_add_to_queue()
    STATE_D->add_to_queue(this_object());
 }
 
+//: FUNCTION stop_state_updates
+// Take this object out of the STATE_D queue. state_update() will not be
+// called again until the object is queued anew.
+void stop_state_updates()
+{
+   STATE_D->remove_from_queue(this_object());
+}
+
 //: FUNCTION set_call_interval
 // int set_call_interval(int i)
 // Set call interval in minutes.
@@ -269,7 +269,6 @@ void do_wander()
    int i;
    string chosen_dir;
    string file;
-   object dest;
 
    if (environment(this_object()))
       directions = environment(this_object())->query_exit_directions();
@@ -286,42 +285,29 @@ void do_wander()
       call = call_out(( : do_wander:), query_wander_time());
       return;
    }
-   /* If the destination is not loaded, do so */
-   dest = find_object(file);
 
-   if (!dest)
-      dest = load_object(file);
-
-   /* If still no destination it won't load, try again next time */
-   if (!dest)
-   {
-      call = call_out(( : do_wander:), query_wander_time());
-      return;
-   }
-
-   /* Check if the npc has wander restrictions */
+   /* Check the destination, and any wander restrictions, against the room
+    * graph so that the room need not be loaded. If there is no such room
+    * try again next time. */
    if (sizeof(wander_area))
    {
-      if (arrayp(wander_area) && arrayp(dest->query_area()))
+      if (ROOM_GRAPH_D->room_in_area(file, wander_area) == 1)
       {
-         if (sizeof(wander_area & dest->query_area()))
-         {
-            move_me(chosen_dir);
-         }
-         else
-         {
-            call = call_out(( : do_wander:), query_wander_time());
-         }
+         move_me(chosen_dir);
       }
       else
       {
          call = call_out(( : do_wander:), query_wander_time());
       }
    }
-   else
+   else if (ROOM_GRAPH_D->room_exists(file))
    {
       move_me(chosen_dir);
    }
+   else
+   {
+      call = call_out(( : do_wander:), query_wander_time());
+   }
    return;
 }
 
@@ -126,6 +126,9 @@ void create(mixed *args...)
 
       setup(args...);
    }
+
+   // Index clones by file, domain and type. See REGISTRY_D.
+   REGISTRY_D->join();
 }
 
 /* arbitrate some stuff that was stubbed in BASE_OBJ */
@@ -33,17 +33,33 @@ varargs mixed call_hooks();
 /* this one is here, but this is a forward declaration. */
 string query_in_room_desc();
 
+//: FUNCTION description_changed
+// Called when the description of the object changes.  Does nothing here;
+// rooms use it to throw away their cached renderings.
+void description_changed()
+{
+}
+
 //: FUNCTION set_long
 // Set the long description of an object
 nomask void set_long(mixed str)
 {
    long = str;
+   description_changed();
    if (functionp(long))
       return;
    if (long == "" || long[ < 1] != '\n')
       long += "\n";
 }
 
+//: FUNCTION query_dynamic_long
+// Returns 1 if the long description is a function, and so may read
+// differently every time.
+int query_dynamic_long()
+{
+   return functionp(long);
+}
+
 //: FUNCTION get_base_long
 // Get the variable long, not the full description...
 string get_base_long()
@@ -92,11 +108,11 @@ string untouched_long()
 
 //: FUNCTION show_in_room
 // Return a string appropriate for including in a room long description.
-// Note that duplicatep() objects return nothing.
-string show_in_room()
+// Note that duplicatep() objects return nothing.  our_count is the number
+// of identical objects being described together, counted if not given.
+varargs string show_in_room(int our_count)
 {
    string str;
-   int our_count;
    if (!is_visible())
       return 0;
    /* If an object is attached, it is considered part of its
@@ -109,7 +125,8 @@ string show_in_room()
     */
    if (is_attached())
       return 0;
-   our_count = count();
+   if (!our_count)
+      our_count = count();
    if (our_count > 4)
    {
       if (plural_in_room_desc)
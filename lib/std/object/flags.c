@@ -83,6 +83,7 @@ void set_flags(int which, int state)
    int set_key;
    class flag_set_info set_info;
    int value;
+   int old;
 
    if (!flag_sets)
       init_vars();
@@ -92,7 +93,7 @@ void set_flags(int which, int state)
    if (!set_info)
       set_info = flag_sets[set_key] = new (class flag_set_info);
 
-   value = get_flags(set_key);
+   value = old = get_flags(set_key);
    if (state)
       value |= BITMASK(which);
    else
@@ -112,6 +113,12 @@ void set_flags(int which, int state)
    */
    if (set_info.change_func)
       evaluate(set_info.change_func, which, state);
+
+   /* Flags show up in get_attributes() and ob_state(), so our
+   ** environment has to group us again in inventory listings.
+   */
+   if (value != old && environment())
+      environment()->invalidate_groups();
 }
 
 //: FUNCTION configure_set
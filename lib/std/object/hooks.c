@@ -54,6 +54,14 @@ void remove_hook(string tag, function hook)
       map_delete(hooks, tag);
 }
 
+//: FUNCTION has_hooks
+//
+// Returns 1 if any hooks are set up for the tag.
+int has_hooks(string tag)
+{
+   return !!hooks[tag];
+}
+
 //: FUNCTION hook_state
 //
 // hook_state(tag, hook, state) Either add or remove a hook based on the
@@ -66,85 +74,186 @@ void hook_state(string tag, mixed hook, int state)
       remove_hook(tag, hook);
 }
 
-//: FUNCTION call_hooks
-//
-// Call a set of hooks, with the specified method for resolving multiple
-// hooks.  A setting from /include/hooks.h can be used, or a function pointer
-// which is appropriate for implode()ing with the return values.
-//
-// E.g.
-//
-// call_hooks("foo", (: $1 + $2 :), 2) will return 2 + the sum of the return
-//     values of the hooks
-//
-// but 2 + call_hooks("foo", HOOK_SUM) is faster.
-//
-// see: implode
-// see: add_hook
+private
+mixed no_hooks(mixed func, mixed start)
+{
+   if (!intp(func))
+      return start;
 
-varargs mixed call_hooks(string tag, mixed func, mixed start, mixed *args...)
+   switch (func)
+   {
+   case HOOK_IGNORE:
+   case HOOK_SUM:
+   case HOOK_LOR:
+      return 0;
+   case HOOK_LAND:
+      return 1;
+   case HOOK_YES_NO_ERROR:
+      return (start || 1);
+   default:
+      error("Unknown hook type in call_hooks.\n");
+   }
+}
+
+/* Drop the hooks whose owners have been destructed */
+private
+void compact_hooks(string tag)
+{
+   if (!hooks[tag])
+      return;
+   hooks[tag] = filter(hooks[tag], ( : !(functionp($1) & FP_OWNER_DESTED) :));
+   if (!sizeof(hooks[tag]))
+      map_delete(hooks, tag);
+}
+
+/* The common case of a single hook, without looping */
+private
+mixed call_one_hook(string tag, function hook, mixed func, mixed start, mixed *args)
 {
-   mixed *hooks_to_call;
    mixed tmp;
-   function hook;
 
-   if (hooks_to_call = hooks[tag])
+   if (functionp(hook) & FP_OWNER_DESTED)
    {
-      hooks_to_call = filter(hooks_to_call, ( : !(functionp($1) & FP_OWNER_DESTED) :));
-      hooks[tag] = hooks_to_call;
+      compact_hooks(tag);
+      return no_hooks(func, start);
+   }
+   tmp = evaluate(hook, args...);
 
-      if (!intp(func))
-         return implode(map(hooks_to_call, ( : evaluate($1, $(args)...) :)), func, start);
-      switch (func)
-      {
-      case HOOK_IGNORE:
-         map(hooks_to_call, ( : evaluate($1, $(args)...) :));
-         return 0;
-      case HOOK_SUM:
-         foreach (hook in hooks_to_call)
-            tmp += evaluate(hook, args...);
+   if (!intp(func))
+      return evaluate(func, start, tmp);
+   switch (func)
+   {
+   case HOOK_IGNORE:
+      return 0;
+   case HOOK_SUM:
+   case HOOK_LOR:
+      return tmp;
+   case HOOK_LAND:
+      return !!tmp;
+   case HOOK_YES_NO_ERROR:
+      if (!tmp || stringp(tmp))
          return tmp;
-      case HOOK_LAND:
-         foreach (hook in hooks_to_call)
-            if (!evaluate(hook, args...))
-               return 0;
-         return 1;
-      case HOOK_LOR:
-         foreach (hook in hooks_to_call)
-            if (tmp = evaluate(hook, args...))
-               return tmp;
-         return 0;
-      case HOOK_YES_NO_ERROR:
-         foreach (hook in hooks_to_call)
-         {
-            tmp = evaluate(hook, args...);
-            if (!tmp || stringp(tmp))
-               return tmp;
-         }
-         return (start || 1);
-      default:
-         error("Unknown hook type in call_hooks.\n");
+      return (start || 1);
+   default:
+      error("Unknown hook type in call_hooks.\n");
+   }
+}
+
+private
+mixed call_all_hooks(string tag, mixed *hooks_to_call, mixed func, mixed start, mixed *args)
+{
+   mixed tmp;
+   mixed ret;
+   int dested;
+
+   /*
+   ** Hooks may be added or removed by the hooks themselves; that replaces
+   ** hooks[tag], so the array we walk here stays as it was.
+   */
+   if (!intp(func))
+   {
+      ret = start;
+      foreach (mixed hook in hooks_to_call)
+      {
+         if (functionp(hook) & FP_OWNER_DESTED)
+            dested = 1;
+         else
+            ret = evaluate(func, ret, evaluate(hook, args...));
       }
    }
    else
    {
-      if (!intp(func))
-         return start;
-
       switch (func)
       {
       case HOOK_IGNORE:
       case HOOK_SUM:
-      case HOOK_LOR:
-         return 0;
+         break;
       case HOOK_LAND:
-         return 1;
+         ret = 1;
+         break;
+      case HOOK_LOR:
+         break;
       case HOOK_YES_NO_ERROR:
-         return (start || 1);
+         ret = (start || 1);
+         break;
       default:
          error("Unknown hook type in call_hooks.\n");
       }
+      foreach (mixed hook in hooks_to_call)
+      {
+         if (functionp(hook) & FP_OWNER_DESTED)
+         {
+            dested = 1;
+            continue;
+         }
+         tmp = evaluate(hook, args...);
+         if (func == HOOK_SUM)
+            ret += tmp;
+         else if (func == HOOK_LAND && !tmp)
+         {
+            ret = 0;
+            break;
+         }
+         else if (func == HOOK_LOR && tmp)
+         {
+            ret = tmp;
+            break;
+         }
+         else if (func == HOOK_YES_NO_ERROR && (!tmp || stringp(tmp)))
+         {
+            ret = tmp;
+            break;
+         }
+      }
    }
+   if (dested)
+      compact_hooks(tag);
+   return ret;
+}
+
+//: FUNCTION call_hooks
+//
+// Call a set of hooks, with the specified method for resolving multiple
+// hooks.  A setting from /include/hooks.h can be used, or a function pointer
+// which is appropriate for implode()ing with the return values.
+//
+// E.g.
+//
+// call_hooks("foo", (: $1 + $2 :), 2) will return 2 + the sum of the return
+//     values of the hooks
+//
+// but 2 + call_hooks("foo", HOOK_SUM) is faster.
+//
+// The hooks are called straight from the list kept by add_hook(); hooks
+// whose owners were destructed are skipped, and dropped from the list
+// afterwards.  With HOOK_STATS defined in config.h the calls and eval cost
+// are counted per tag across the mud by HOOK_STATS_D.
+//
+// see: implode
+// see: add_hook
+
+varargs mixed call_hooks(string tag, mixed func, mixed start, mixed *args...)
+{
+   mixed *hooks_to_call = hooks[tag];
+   mixed ret;
+#ifdef HOOK_STATS
+   int cost;
+#endif
+
+   if (!hooks_to_call)
+      return no_hooks(func, start);
+
+#ifdef HOOK_STATS
+   cost = eval_cost();
+#endif
+   if (sizeof(hooks_to_call) == 1)
+      ret = call_one_hook(tag, hooks_to_call[0], func, start, args);
+   else
+      ret = call_all_hooks(tag, hooks_to_call, func, start, args);
+#ifdef HOOK_STATS
+   HOOK_STATS_D->hooks_called(tag, cost - eval_cost());
+#endif
+   return ret;
 }
 
 mapping debug_hooks()
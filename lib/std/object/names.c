@@ -15,6 +15,9 @@ string primary_id, primary_adj;
 /* calculated internally */
 private
 nosave mixed internal_short;
+/* set when the names change; the above is worked out again when next needed */
+private
+nosave int names_dirty;
 /* unique objects are refered to as 'the' instead of 'a' */
 private
 nosave int unique;
@@ -39,6 +42,8 @@ int test_flag(mixed);
 varargs mixed call_hooks(string, mixed, mixed);
 private
 void resync();
+private
+void names_changed();
 varargs string get_attributes(object ob);
 
 void create()
@@ -56,7 +61,7 @@ void create()
 void set_proper_name(string str)
 {
    proper_name = str;
-   resync();
+   names_changed();
 }
 
 //: FUNCTION set_unique
@@ -87,9 +92,11 @@ int query_plural()
    return plural;
 }
 
+/* Work out the primary id and adjective, and our short, from the names */
 private
 void resync()
 {
+   names_dirty = 0;
    if (!proper_name)
    {
       if (!primary_id && sizeof(ids))
@@ -111,11 +118,39 @@ void resync()
    }
    else
       internal_short = proper_name;
+}
+
+/*
+** Called whenever the names change.  A setup() may change them a dozen
+** times, so rather than working out the primary names and the short each
+** time, we note that it needs doing and resync() when something asks; see
+** sync_names().  The parser caches what it saw, so it is told every time.
+*/
+private
+void names_changed()
+{
+   names_dirty = 1;
    parse_refresh();
+
+   /* ob_state() is our short, so our environment has to group us again,
+    * and index us under our new names */
+   if (environment())
+   {
+      environment()->invalidate_groups();
+      environment()->update_name_index();
+   }
+}
+
+private
+void sync_names()
+{
+   if (names_dirty)
+      resync();
 }
 
 mixed ob_state()
 {
+   sync_names();
    return internal_short;
 }
 
@@ -131,6 +166,7 @@ string short()
 {
    if (!this_object()->is_visible())
       return this_object()->invis_name();
+   sync_names();
    return evaluate(internal_short);
 }
 
@@ -227,7 +263,7 @@ void add_adj(string *adj...)
       adjs = adj;
    else
       adjs += adj;
-   resync();
+   names_changed();
 }
 
 //: FUNCTION add_plural
@@ -238,7 +274,7 @@ void add_plural(string *plural...)
       plurals = plural;
    else
       plurals += plural;
-   resync();
+   names_changed();
 }
 
 //: FUNCTION add_id_no_plural
@@ -250,7 +286,7 @@ void add_id_no_plural(string *id...)
       ids = id;
    else
       ids += id;
-   resync();
+   names_changed();
 }
 
 //: FUNCTION add_id
@@ -262,7 +298,7 @@ void add_id(string *id...)
    else
       ids += id;
    plurals += map(id, ( : pluralize:));
-   resync();
+   names_changed();
 }
 
 /****** set_ ******/
@@ -272,7 +308,7 @@ void set_id(string *id...)
    ids = id + ids; // Ensure proper order for resync of primary id
    plurals += map(id, ( : pluralize:));
    primary_id = 0;
-   resync();
+   names_changed();
 }
 
 void set_adj(string *adj...)
@@ -282,7 +318,22 @@ void set_adj(string *adj...)
    else
       adjs = adj + adjs; // Ensure proper order for resync of primary adj
    primary_adj = 0;
-   resync();
+   names_changed();
+}
+
+//: FUNCTION set_names
+// Sets all the names in one go, replacing any set before: the ids, each
+// with its plural, and optionally the adjectives and extra plurals.  The
+// first id and adjective become the primary ones.  The same as a run of
+// set_id(), set_adj() and add_plural(), but clearer in a setup().
+varargs void set_names(string *id, string *adj, string *plural)
+{
+   ids = id || ({});
+   plurals = map(ids, ( : pluralize:)) + (plural || ({}));
+   adjs = adj || ({});
+   primary_id = 0;
+   primary_adj = 0;
+   names_changed();
 }
 
 /****** remove_ ******/
@@ -295,7 +346,7 @@ void remove_id(string *id...)
    ids -= id;
    plurals -= map(id, ( : pluralize:));
    primary_id = 0;
-   resync();
+   names_changed();
 }
 
 void remove_adj(string *adj...)
@@ -304,7 +355,7 @@ void remove_adj(string *adj...)
       return;
    adjs -= adj;
    primary_adj = 0;
-   resync();
+   names_changed();
 }
 
 /****** clear_ ******/
@@ -316,7 +367,7 @@ void clear_id()
    ids = ({});
    plurals = ({});
    primary_id = 0;
-   resync();
+   names_changed();
 }
 
 //: FUNCTION clear_adj
@@ -325,7 +376,7 @@ void clear_adj()
 {
    adjs = ({});
    primary_adj = 0;
-   resync();
+   names_changed();
 }
 
 /****** query_ ******/
@@ -346,6 +397,7 @@ string *query_id()
 // Returns the primary id of an object
 string query_primary_id()
 {
+   sync_names();
    return primary_id;
 }
 
@@ -353,6 +405,7 @@ string query_primary_id()
 // Returns the primary adj of an object
 string query_primary_adj()
 {
+   sync_names();
    return primary_adj;
 }
 
@@ -360,6 +413,7 @@ string query_primary_adj()
 // Returns the primary name (primary adj + primary id) of an object
 string query_primary_name()
 {
+   sync_names();
    return (primary_adj ? primary_adj + " " : "") + primary_id;
 }
 
@@ -370,6 +424,15 @@ string *query_adj()
    return adjs;
 }
 
+//: FUNCTION query_name_words
+// Returns every word we might answer to: ids, plurals and adjectives.
+// Containers index their contents by these, see query_named() in
+// CONTAINER, so anything that answers to more in id() has to add it here.
+string *query_name_words()
+{
+   return query_id() + (plurals || ({})) + (adjs || ({}));
+}
+
 /****** parser interaction ******/
 
 string *parse_command_id_list()
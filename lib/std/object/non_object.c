@@ -12,9 +12,12 @@ void set_light(int);
 //: FUNCTION remove
 // This function is guaranteed to be called when an object is destructed.
 // It tidies up some things like updating its environment's capacity and
-// light level.  It also calls the "remove" hook.
+// light level.  It also calls the "remove" hook, and takes the object out
+// of REGISTRY_D.
 int remove()
 {
+   if (clonep())
+      REGISTRY_D->leave();
    if (environment())
       environment()->release_object(this_object(), 1);
 
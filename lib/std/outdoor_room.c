@@ -14,6 +14,13 @@ void mudlib_setup()
    add_id_no_plural("ground");
 }
 
+// The weather is part of our description, so cached renderings of the
+// room go stale when it changes.
+int query_render_generation()
+{
+   return ::query_render_generation() + (query_weather() ? WEATHER_D->query_generation() : 0);
+}
+
 // Make weather show something....
 string get_extra_long()
 {
@@ -2,72 +2,224 @@
 
 #include <playerflags.h>
 
+/*
+** Rendered pieces of the room description, kept per viewer class so the
+** next look doesn't have to build them again.  Brief viewers never ask for
+** the long, so it is only filled in once somebody verbose looks.  The
+** lines for livings are left out of rows and built on every look, since
+** they change all the time and depend on who is looking.
+*/
+class rendering
+{
+   int generation;
+   string long;  /* fancy_long(), or 0 */
+   string exits; /* show_exits(), or 0 */
+   mixed *rows;  /* listing lines, with the livings to describe in between */
+}
+
 private
 nosave string remote_desc;
+private
+nosave int render_generation;
+private
+nosave mapping renderings = ([]);
+private
+nosave int render_cache_off;
+private
+nosave int render_hits, render_misses;
 
 int query_light();
 string short();
 string show_exits();
 string *query_area();
 string long();
+string fancy_long();
 int query_combat_forbidden();
+varargs mixed *query_groups(string relation);
+int query_dynamic_long();
+int has_hooks(string tag);
 
-//: FUNCTION show_objects
-// Return a string describing the objects in the room
-varargs string show_objects(object except)
+//: FUNCTION bump_render_generation
+// Marks the cached renderings of the room as out of date.  Called when
+// anything in the room, its exits, doors, description or state change.
+void bump_render_generation()
+{
+   render_generation++;
+}
+
+//: FUNCTION query_render_generation
+// The generation cached renderings are checked against.  Rooms whose
+// description depends on something outside of them add that in, see
+// outdoor_room.c.
+int query_render_generation()
+{
+   return render_generation;
+}
+
+//: FUNCTION set_render_cache
+// set_render_cache(0) turns off the caching of rendered descriptions, for
+// rooms whose description changes without telling us.
+void set_render_cache(int on)
+{
+   render_cache_off = !on;
+   renderings = ([]);
+}
+
+//: FUNCTION query_render_stats
+// Returns how often a look found its rendering cached, and how often it
+// had to be built.
+mapping query_render_stats()
+{
+   return (["generation":query_render_generation(), "hits":render_hits, "misses":render_misses]);
+}
+
+/* Wizards see hidden exits and annotations, so they get their own */
+private
+class rendering query_rendering()
+{
+   string viewer = this_user() && wizardp(this_user()) ? "wizard" : "mortal";
+   class rendering r = renderings[viewer];
+   int gen = query_render_generation();
+
+   if (r && r.generation == gen)
+   {
+      render_hits++;
+      return r;
+   }
+   render_misses++;
+   r = new (class rendering, generation:gen);
+   renderings[viewer] = r;
+   return r;
+}
+
+//: FUNCTION rendered_long
+// fancy_long(), from the cache when nothing changed since the last look.
+// Descriptions that are functions or have extra_long hooks are built
+// every time.
+string rendered_long()
+{
+   class rendering r;
+
+   if (render_cache_off || query_dynamic_long() || has_hooks("extra_long"))
+      return fancy_long();
+   r = query_rendering();
+   if (!r.long)
+      r.long = fancy_long();
+   return r.long;
+}
+
+//: FUNCTION rendered_exits
+// show_exits(), from the cache when nothing changed since the last look.
+string rendered_exits()
+{
+   class rendering r;
+
+   if (render_cache_off)
+      return show_exits();
+   r = query_rendering();
+   if (!r.exits)
+      r.exits = show_exits();
+   return r.exits;
+}
+
+/* The listing of the room, in reverse inventory order: strings for the
+ * objects and their contents, and the livings themselves. */
+private
+mixed *object_rows(object except)
 {
    object *obs;
-   string user_show;
-   string obj_show;
+   mixed *rows = ({});
    string str;
    int n;
-   object link;
+   mapping shown = ([]);
+   mapping leaders = ([]);
+   object *members;
 
-   obs = filter(all_inventory() - ({this_body()}), ( : $1->is_visible() :));
+   obs = filter(all_inventory(), ( : $1->is_visible() :));
    if (except)
    {
       obs -= ({except});
    }
 
-   n = sizeof(obs);
-   user_show = "";
-   obj_show = "";
+   /* Each group of identical objects is described once, by its first member */
+   foreach (object ob in obs)
+      shown[ob] = 1;
+   foreach (object *group in query_groups())
+   {
+      members = filter(group, ( : $(shown)[$1] :));
+      if (sizeof(members))
+         leaders[members[0]] = sizeof(members);
+   }
 
+   n = sizeof(obs);
    while (n--)
    {
       if (obs[n]->is_living())
+         rows += ({obs[n]});
+      else if (leaders[obs[n]])
       {
-         str = obs[n]->in_room_desc();
-         if ((link = obs[n]->query_link()) && userp(link))
-         {
-            if (except)
-               str += sprintf(" (outside %s)", except->the_short());
-            user_show += str + "\n";
-            continue;
-         }
-         if (strlen(str))
+         if ((str = obs[n]->show_in_room(leaders[obs[n]])) && strlen(str))
          {
             if (except)
                str += sprintf(" (outside %s)", except->the_short());
-            obj_show += str + "\n";
+            rows += ({str + "\n"});
          }
+
+         // Comment out the two lines below to hide contents of things in rooms.
+         // Stanach likes that.
+         if (obs[n]->inventory_visible() && !obs[n]->query_hide_contents())
+            rows += ({obs[n]->show_contents()});
       }
-      else
+   }
+   return rows;
+}
+
+//: FUNCTION show_objects
+// Return a string describing the objects in the room
+varargs string show_objects(object except)
+{
+   mixed *rows;
+   string user_show;
+   string obj_show;
+   string str;
+   object link;
+   class rendering r;
+
+   if (except || render_cache_off)
+      rows = object_rows(except);
+   else
+   {
+      r = query_rendering();
+      if (!r.rows)
+         r.rows = object_rows(0);
+      rows = r.rows;
+   }
+
+   user_show = "";
+   obj_show = "";
+
+   foreach (mixed row in rows)
+   {
+      if (stringp(row))
       {
-         if (!duplicatep(obs[n]))
-         {
-            if ((str = obs[n]->show_in_room()) && strlen(str))
-            {
-               if (except)
-                  str += sprintf(" (outside %s)", except->the_short());
-               obj_show += str + "\n";
-            }
-
-            // Comment out the two lines below to hide contents of things in rooms.
-            // Stanach likes that.
-            if (obs[n]->inventory_visible() && !obs[n]->query_hide_contents())
-               obj_show += obs[n]->show_contents();
-         }
+         obj_show += row;
+         continue;
+      }
+      if (!row || row == this_body())
+         continue;
+      str = row->in_room_desc();
+      if ((link = row->query_link()) && userp(link))
+      {
+         if (except)
+            str += sprintf(" (outside %s)", except->the_short());
+         user_show += str + "\n";
+         continue;
+      }
+      if (strlen(str))
+      {
+         if (except)
+            str += sprintf(" (outside %s)", except->the_short());
+         obj_show += str + "\n";
       }
    }
    if (except) // We're inside an object
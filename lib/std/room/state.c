@@ -11,6 +11,8 @@ nosave string *room_state = ({});
 private
 nosave mapping room_state_extra_longs = ([]);
 
+void description_changed();
+
 string *get_room_state_info()
 {
    return copy(room_state);
@@ -35,12 +37,14 @@ void set_room_state(string state)
 {
    room_state -= ({state + "_off", state + "_on"});
    room_state += ({state + "_on"});
+   description_changed();
 }
 
 void clear_room_state(string state)
 {
    room_state -= ({state + "_on", state + "_off"});
    room_state += ({state + "_off"});
+   description_changed();
 }
 
 void set_state_description(string state, mixed desc)
@@ -60,4 +64,5 @@ void set_state_description(string state, mixed desc)
          clear_room_state(state[0.. < 5]);
    }
    room_state_extra_longs[state] = desc;
+   description_changed();
 }
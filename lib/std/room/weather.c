@@ -10,9 +10,12 @@
 
 nosave private int weather;
 
+void description_changed();
+
 void set_weather(int new_weather)
 {
    weather = new_weather;
+   description_changed();
 }
 int query_weather()
 {
@@ -124,7 +124,8 @@ mixed default_checks()
    return 1;
 }
 
-void handle_obs(mixed *info, function callback, mixed extra...)
+private
+void handle_each(mixed *info, function callback, mixed *extra)
 {
    foreach (mixed ob in info)
    {
@@ -138,6 +139,25 @@ void handle_obs(mixed *info, function callback, mixed extra...)
    }
 }
 
+void handle_obs(mixed *info, function callback, mixed extra...)
+{
+   object *containers;
+
+   if (sizeof(info) < 2)
+   {
+      handle_each(info, callback, extra);
+      return;
+   }
+
+   /* Things like "get all" move lots of objects between the same few
+    * containers, so they catch up on their bookkeeping once at the end */
+   containers = map(filter(info, ( : objectp:)), ( : environment:));
+   if (this_body())
+      containers += ({this_body(), environment(this_body())});
+   containers = keys(mkmapping(containers, containers));
+   batch_moves(containers, ( : handle_each, info, callback, extra:));
+}
+
 /* we defined the rule, so assume by default we allow it */
 mixed can_verb_rule(string verb, string rule)
 {